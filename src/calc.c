@@ -3,17 +3,37 @@
 #include "parser.h"
 #include "executor.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include "ctype.h"
 
 int main() {
+    /* liczba wątków do dużych operacji, domyślnie jeden*/
+    const char *threads = getenv("POLY_THREADS");
+    if (threads != NULL) {
+        PolySetThreads((size_t) strtoul(threads, NULL, 10));
+    }
+    /* równe poddrzewa wielomianów na stosie zajmują pamięć raz*/
+    const char *hash_consing = getenv("POLY_HASH_CONS");
+    if (hash_consing != NULL) {
+        PolySetHashConsing(strtoul(hash_consing, NULL, 10) != 0);
+    }
+    /* duże iloczyny w postaci rozproszonej*/
+    const char *dist_mul = getenv("POLY_DIST_MUL");
+    if (dist_mul != NULL) {
+        PolySetDistMul(strtoul(dist_mul, NULL, 10) != 0);
+    }
+    /* limit pamięci podręcznej wyników MUL i COMPOSE w bajtach*/
+    const char *cache = getenv("POLY_CACHE");
+    if (cache != NULL) {
+        PolySetResultCache((size_t) strtoull(cache, NULL, 10));
+    }
     Stack s = StackCreate();
     int line_number = 1;
     int c;
     Commands commands;
     CommandParams params;
     Poly poly;
-    while ((c = getchar()) != EOF) {
-        ungetc(c, stdin);
+    while ((c = PeekChar()) != EOF) {
         if (isalpha(c)) {
             if (ParseCommand(line_number, &commands, &params)) {
                 ExecuteCommand(commands, params, &s, line_number);
@@ -22,7 +42,7 @@ int main() {
             SkipLine();
         } else if (c == '(' || c == '-' || isdigit(c)) {
             if (ParsePoly(line_number, &poly)) {
-                Push(&s, &poly);
+                PushResult(&s, &poly);
             }
         } else {
             SkipLine();
@@ -31,6 +51,7 @@ int main() {
         ++line_number;
     }
     StackDestroy(&s);
+    ParserDestroy();
     return 0;
 }
 
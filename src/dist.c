@@ -0,0 +1,430 @@
+/** @file
+  Implementacja rozproszonej reprezentacji wielomianów
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "dist.h"
+#include "heap.h"
+#include "pool.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * Daje szerokość pola wykładnika jednej zmiennej.
+ * @param[in] nvars : liczba zmiennych
+ * @return liczba bitów pola
+ */
+static unsigned DistBits(size_t nvars) {
+    return (unsigned) (64 / nvars);
+}
+
+/**
+ * Daje przesunięcie pola wykładnika zmiennej. Zmienna @f$x_0@f$ leży
+ * w najstarszym polu.
+ * @param[in] nvars : liczba zmiennych
+ * @param[in] var_idx : indeks zmiennej
+ * @return przesunięcie pola w bitach
+ */
+static unsigned DistShift(size_t nvars, size_t var_idx) {
+    return DistBits(nvars) * (unsigned) (nvars - 1 - var_idx);
+}
+
+/**
+ * Daje maskę bitów ochronnych wszystkich pól.
+ * @param[in] nvars : liczba zmiennych
+ * @return maska bitów ochronnych
+ */
+static uint64_t DistGuardMask(size_t nvars) {
+    uint64_t mask = 0;
+    for (size_t v = 0; v < nvars; ++v) {
+        mask |= UINT64_C(1) << (DistShift(nvars, v) + DistBits(nvars) - 1);
+    }
+    return mask;
+}
+
+/**
+ * Sprawdza, czy wielomian zmiennych @f$x_{var\_idx}, x_{var\_idx + 1}, \ldots@f$
+ * da się zapisać w postaci rozproszonej i liczy jego niezerowe wyrazy.
+ * @param[in] p : wielomian
+ * @param[in] var_idx : indeks pierwszej zmiennej
+ * @param[in] nvars : liczba zmiennych
+ * @param[in,out] count : licznik wyrazów
+ * @return Czy wielomian da się zapisać?
+ */
+static bool DistFitsHelper(const Poly *p, size_t var_idx, size_t nvars, size_t *count) {
+    if (PolyIsCoeff(p)) {
+        *count += (p->coeff != 0);
+        return true;
+    }
+    /* w polach szerszych niż 32 bity mieści się każdy wykładnik poly_exp_t*/
+    poly_exp_t limit = (DistBits(nvars) >= 32) ? INT32_MAX
+                                               : (poly_exp_t) ((UINT64_C(1) << (DistBits(nvars) - 1)) - 1);
+    if (var_idx >= nvars) {
+        return false;
+    }
+    if (PolyIsInline(p)) {
+        (*count)++;
+        return PolyInlineExp(p) <= limit;
+    }
+    if (MonoGetExp(&p->arr[p->size - 1]) > limit) {
+        return false;
+    }
+    for (size_t i = 0; i < p->size; ++i) {
+        if (!DistFitsHelper(&p->arr[i].p, var_idx + 1, nvars, count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DistFits(const Poly *p, size_t nvars) {
+    size_t count = 0;
+    return nvars > 0 && nvars <= DIST_MAX_VARS && DistFitsHelper(p, 0, nvars, &count);
+}
+
+/**
+ * Zapisuje wyrazy wielomianu w postaci rozproszonej w kolejności
+ * rosnących upakowanych wykładników.
+ * @param[in] p : wielomian zmiennych @f$x_{var\_idx}, x_{var\_idx + 1}, \ldots@f$
+ * @param[in] var_idx : indeks pierwszej zmiennej
+ * @param[in] base : upakowane wykładniki zmiennych przed @f$x_{var\_idx}@f$
+ * @param[in,out] d : wielomian w postaci rozproszonej
+ */
+static void DistPack(const Poly *p, size_t var_idx, uint64_t base, DistPoly *d) {
+    if (PolyIsCoeff(p)) {
+        if (p->coeff != 0) {
+            d->exps[d->count] = base;
+            d->coeffs[d->count++] = p->coeff;
+        }
+        return;
+    }
+    unsigned shift = DistShift(d->nvars, var_idx);
+    if (PolyIsInline(p)) {
+        d->exps[d->count] = base | ((uint64_t) PolyInlineExp(p) << shift);
+        d->coeffs[d->count++] = p->coeff;
+        return;
+    }
+    for (size_t i = 0; i < p->size; ++i) {
+        DistPack(&p->arr[i].p, var_idx + 1, base | ((uint64_t) MonoGetExp(&p->arr[i]) << shift), d);
+    }
+}
+
+/**
+ * Przydziela tablice wielomianu w postaci rozproszonej.
+ * @param[in] nvars : liczba zmiennych
+ * @param[in] capacity : pojemność tablic
+ * @return wielomian bez wyrazów
+ */
+static DistPoly DistInit(size_t nvars, size_t capacity) {
+    if (capacity == 0) {
+        capacity = 1;
+    }
+    return (DistPoly) {.count = 0, .nvars = nvars,
+                       .exps = PoolAlloc(sizeof(uint64_t) * capacity),
+                       .coeffs = PoolAlloc(sizeof(poly_coeff_t) * capacity)};
+}
+
+DistPoly DistFromPoly(const Poly *p, size_t nvars) {
+    size_t count = 0;
+    bool fits = DistFitsHelper(p, 0, nvars, &count);
+    assert(fits && nvars > 0 && nvars <= DIST_MAX_VARS);
+    (void) fits;
+    DistPoly d = DistInit(nvars, count);
+    DistPack(p, 0, 0, &d);
+    return d;
+}
+
+/**
+ * Odtwarza wielomian z wyrazów o wspólnych wykładnikach zmiennych przed
+ * @f$x_{var\_idx}@f$.
+ * @param[in] d : wielomian w postaci rozproszonej
+ * @param[in] begin : pierwszy wyraz
+ * @param[in] end : wyraz za ostatnim
+ * @param[in] var_idx : indeks zmiennej
+ * @return wielomian
+ */
+static Poly DistToPolyHelper(const DistPoly *d, size_t begin, size_t end, size_t var_idx) {
+    if (var_idx == d->nvars) {
+        assert(end - begin == 1);
+        return PolyFromCoeff(d->coeffs[begin]);
+    }
+    unsigned shift = DistShift(d->nvars, var_idx);
+    uint64_t field = (d->nvars == 1) ? UINT64_MAX : (UINT64_C(1) << DistBits(d->nvars)) - 1;
+    size_t groups = 0;
+    for (size_t i = begin; i < end; ++i) {
+        groups += (i == begin || (d->exps[i] >> shift) != (d->exps[i - 1] >> shift));
+    }
+    Mono *monos = PoolAlloc(sizeof(struct Mono) * groups);
+    size_t group_begin = begin;
+    for (size_t g = 0; g < groups; ++g) {
+        size_t group_end = group_begin + 1;
+        while (group_end < end && (d->exps[group_end] >> shift) == (d->exps[group_begin] >> shift)) {
+            group_end++;
+        }
+        monos[g] = (Mono) {.p = DistToPolyHelper(d, group_begin, group_end, var_idx + 1),
+                           .exp = (poly_exp_t) ((d->exps[group_begin] >> shift) & field)};
+        group_begin = group_end;
+    }
+    Poly result = PolyAddMonos(groups, monos);
+    PoolFree(monos);
+    return result;
+}
+
+Poly DistToPoly(const DistPoly *d) {
+    return (d->count == 0) ? PolyZero() : DistToPolyHelper(d, 0, d->count, 0);
+}
+
+void DistDestroy(DistPoly *d) {
+    PoolFree(d->exps);
+    PoolFree(d->coeffs);
+    d->exps = NULL;
+    d->coeffs = NULL;
+}
+
+bool DistIsEq(const DistPoly *a, const DistPoly *b) {
+    assert(a->nvars == b->nvars);
+    return a->count == b->count
+           && memcmp(a->exps, b->exps, sizeof(uint64_t) * a->count) == 0
+           && memcmp(a->coeffs, b->coeffs, sizeof(poly_coeff_t) * a->count) == 0;
+}
+
+/**
+ * Dopisuje wyraz na koniec wielomianu w postaci rozproszonej, w razie
+ * potrzeby powiększając tablice. Pomija zerowe współczynniki.
+ * @param[in,out] d : wielomian w budowie
+ * @param[in,out] capacity : pojemność tablic
+ * @param[in] exp : upakowany wykładnik, większy od dotychczasowych
+ * @param[in] coeff : współczynnik
+ */
+static void DistAppend(DistPoly *d, size_t *capacity, uint64_t exp, poly_coeff_t coeff) {
+    if (coeff == 0) {
+        return;
+    }
+    if (d->count == *capacity) {
+        *capacity *= 2;
+        d->exps = PoolRealloc(d->exps, sizeof(uint64_t) * *capacity);
+        d->coeffs = PoolRealloc(d->coeffs, sizeof(poly_coeff_t) * *capacity);
+    }
+    d->exps[d->count] = exp;
+    d->coeffs[d->count++] = coeff;
+}
+
+DistPoly DistAdd(const DistPoly *a, const DistPoly *b) {
+    assert(a->nvars == b->nvars);
+    size_t capacity = a->count + b->count;
+    DistPoly result = DistInit(a->nvars, capacity);
+    capacity = (capacity == 0) ? 1 : capacity;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count || j < b->count) {
+        if (j == b->count || (i < a->count && a->exps[i] < b->exps[j])) {
+            DistAppend(&result, &capacity, a->exps[i], a->coeffs[i]);
+            i++;
+        } else if (i == a->count || b->exps[j] < a->exps[i]) {
+            DistAppend(&result, &capacity, b->exps[j], b->coeffs[j]);
+            j++;
+        } else {
+            DistAppend(&result, &capacity, a->exps[i], a->coeffs[i] + b->coeffs[j]);
+            i++;
+            j++;
+        }
+    }
+    return result;
+}
+
+bool DistMulFits(const DistPoly *a, const DistPoly *b) {
+    assert(a->nvars == b->nvars);
+    if (DistBits(a->nvars) == 64) {
+        /* wykładniki poly_exp_t są mniejsze niż 2^31, suma mieści się w polu*/
+        return true;
+    }
+    /* największe wykładniki poszczególnych zmiennych, pole po polu*/
+    uint64_t guard = DistGuardMask(a->nvars);
+    uint64_t field = (UINT64_C(1) << DistBits(a->nvars)) - 1;
+    uint64_t a_max = 0;
+    uint64_t b_max = 0;
+    for (size_t v = 0; v < a->nvars; ++v) {
+        unsigned shift = DistShift(a->nvars, v);
+        uint64_t a_field = 0;
+        uint64_t b_field = 0;
+        for (size_t i = 0; i < a->count; ++i) {
+            if (((a->exps[i] >> shift) & field) > a_field) {
+                a_field = (a->exps[i] >> shift) & field;
+            }
+        }
+        for (size_t j = 0; j < b->count; ++j) {
+            if (((b->exps[j] >> shift) & field) > b_field) {
+                b_field = (b->exps[j] >> shift) & field;
+            }
+        }
+        a_max |= a_field << shift;
+        b_max |= b_field << shift;
+    }
+    return ((a_max + b_max) & guard) == 0;
+}
+
+/**
+ * Element kopca używanego przy mnożeniu: iloczyn @f$i@f$-tego wyrazu
+ * krótszego czynnika i @f$j@f$-tego wyrazu dłuższego.
+ */
+typedef struct DistHeapEntry {
+    uint64_t exp; ///< upakowany wykładnik iloczynu
+    size_t i; ///< indeks wyrazu krótszego czynnika
+    size_t j; ///< indeks wyrazu dłuższego czynnika
+} DistHeapEntry;
+
+/**
+ * Porównuje elementy kopca według upakowanego wykładnika.
+ * @param[in] lhs : element kopca
+ * @param[in] rhs : element kopca
+ * @return Czy @p lhs ma mniejszy wykładnik niż @p rhs?
+ */
+static bool DistHeapEntryLess(const void *lhs, const void *rhs) {
+    return ((const DistHeapEntry *) lhs)->exp < ((const DistHeapEntry *) rhs)->exp;
+}
+
+/**
+ * Wstawia element do kopca minimalnego (według upakowanego wykładnika).
+ * @param[in,out] heap : kopiec
+ * @param[in,out] size : liczba elementów w kopcu
+ * @param[in] entry : nowy element
+ */
+static void DistHeapPush(DistHeapEntry *heap, size_t *size, DistHeapEntry entry) {
+    HeapInsert(heap, size, sizeof(DistHeapEntry), &entry, DistHeapEntryLess);
+}
+
+/**
+ * Usuwa z kopca minimalnego element o najmniejszym wykładniku.
+ * @param[in,out] heap : niepusty kopiec
+ * @param[in,out] size : liczba elementów w kopcu
+ * @return usunięty element
+ */
+static DistHeapEntry DistHeapPop(DistHeapEntry *heap, size_t *size) {
+    DistHeapEntry top;
+    HeapRemove(heap, size, sizeof(DistHeapEntry), &top, DistHeapEntryLess);
+    return top;
+}
+
+DistPoly DistMul(const DistPoly *a, const DistPoly *b) {
+    assert(DistMulFits(a, b));
+    if (a->count == 0 || b->count == 0) {
+        return DistInit(a->nvars, 0);
+    }
+    const DistPoly *shorter = (a->count <= b->count) ? a : b;
+    const DistPoly *longer = (a->count <= b->count) ? b : a;
+    size_t capacity = longer->count;
+    DistPoly result = DistInit(a->nvars, capacity);
+
+    /* jak w PolyMul: kopiec trzyma dla każdego wyrazu krótszego czynnika najmniejszy niewygenerowany iloczyn*/
+    DistHeapEntry *heap = PoolAlloc(sizeof(DistHeapEntry) * shorter->count);
+    size_t heap_size = 0;
+    DistHeapPush(heap, &heap_size, (DistHeapEntry) {
+            .exp = shorter->exps[0] + longer->exps[0], .i = 0, .j = 0});
+    uint64_t sum_exp = heap[0].exp;
+    poly_coeff_t sum = 0;
+    while (heap_size > 0) {
+        DistHeapEntry top = DistHeapPop(heap, &heap_size);
+        if (top.j + 1 < longer->count) {
+            DistHeapPush(heap, &heap_size, (DistHeapEntry) {
+                    .exp = shorter->exps[top.i] + longer->exps[top.j + 1], .i = top.i, .j = top.j + 1});
+        }
+        if (top.j == 0 && top.i + 1 < shorter->count) {
+            DistHeapPush(heap, &heap_size, (DistHeapEntry) {
+                    .exp = shorter->exps[top.i + 1] + longer->exps[0], .i = top.i + 1, .j = 0});
+        }
+        if (top.exp != sum_exp) {
+            DistAppend(&result, &capacity, sum_exp, sum);
+            sum = 0;
+            sum_exp = top.exp;
+        }
+        sum += shorter->coeffs[top.i] * longer->coeffs[top.j];
+    }
+    DistAppend(&result, &capacity, sum_exp, sum);
+    PoolFree(heap);
+    return result;
+}
+
+/**
+ * Wylicza @f$exp@f$-tą potęgę współczynnika @f$base@f$.
+ * @param[in] base : współczynnik @f$base@f$
+ * @param[in] exp : wykładnik @f$exp@f$
+ * @return @f$base^{exp}@f$
+ */
+static poly_coeff_t DistPower(poly_coeff_t base, uint64_t exp) {
+    poly_coeff_t result = 1;
+    while (exp > 0) {
+        if ((exp & 1) != 0) {
+            result *= base;
+        }
+        exp = exp >> 1;
+        base *= base;
+    }
+    return result;
+}
+
+poly_coeff_t DistEval(const DistPoly *d, const poly_coeff_t xs[]) {
+    uint64_t field = (d->nvars == 1) ? UINT64_MAX : (UINT64_C(1) << DistBits(d->nvars)) - 1;
+    poly_coeff_t result = 0;
+    for (size_t i = 0; i < d->count; ++i) {
+        poly_coeff_t term = d->coeffs[i];
+        for (size_t v = 0; v < d->nvars && term != 0; ++v) {
+            term *= DistPower(xs[v], (d->exps[i] >> DistShift(d->nvars, v)) & field);
+        }
+        result += term;
+    }
+    return result;
+}
+
+/**
+ * Daje liczbę zmiennych wielomianu, czyli głębokość jego drzewa.
+ * @param[in] p : wielomian
+ * @return liczba zmiennych
+ */
+static size_t DistDepth(const Poly *p) {
+    if (PolyIsCoeff(p)) {
+        return 0;
+    }
+    if (PolyIsInline(p)) {
+        return 1;
+    }
+    size_t depth = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        size_t child_depth = DistDepth(&p->arr[i].p);
+        if (child_depth > depth) {
+            depth = child_depth;
+        }
+    }
+    return depth + 1;
+}
+
+bool DistMulTry(const Poly *p, const Poly *q, Poly *result) {
+    size_t p_depth = DistDepth(p);
+    size_t q_depth = DistDepth(q);
+    size_t nvars = (p_depth > q_depth) ? p_depth : q_depth;
+    if (!DistFits(p, nvars) || !DistFits(q, nvars)) {
+        return false;
+    }
+    DistPoly a = DistFromPoly(p, nvars);
+    DistPoly b = DistFromPoly(q, nvars);
+    bool fits = DistMulFits(&a, &b);
+    if (fits) {
+        DistPoly product = DistMul(&a, &b);
+        *result = DistToPoly(&product);
+        DistDestroy(&product);
+    }
+    DistDestroy(&a);
+    DistDestroy(&b);
+    return fits;
+}
+
+Poly DistMulPoly(const Poly *p, const Poly *q) {
+    Poly result;
+    if (!DistMulTry(p, q, &result)) {
+        result = PolyMul(p, q);
+    }
+    return result;
+}
@@ -0,0 +1,134 @@
+/** @file
+  Interfejs rozproszonej reprezentacji wielomianów
+
+  Wielomian w postaci rozproszonej to ciąg wyrazów: współczynnik liczbowy
+  i wektor wykładników wszystkich zmiennych upakowany w jedną liczbę
+  64-bitową. Każda z @f$n@f$ zmiennych dostaje pole szerokości
+  @f$\lfloor 64 / n \rfloor@f$ bitów, a zmienna @f$x_0@f$ leży w najstarszym
+  polu, więc porządek upakowanych wykładników jest porządkiem
+  leksykograficznym, tym samym co w postaci rekurencyjnej. Najstarszy bit
+  każdego pola jest bitem ochronnym: wykładniki są mniejsze niż
+  @f$2^{b - 1}@f$, więc suma dwóch wektorów nie przenosi się do następnego
+  pola, a przepełnienie widać po bitach ochronnych.
+
+  Porównanie jednomianów jest jednym porównaniem liczb, a mnożenie
+  jednomianów jednym dodawaniem, dlatego ta postać nadaje się do dużych
+  iloczynów rzadkich wielomianów wielu zmiennych.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef DIST_H
+#define DIST_H
+
+#include "poly.h"
+
+/** Największa liczba zmiennych postaci rozproszonej: każde pole ma co najmniej 2 bity */
+#define DIST_MAX_VARS 32
+
+/**
+ * To jest struktura przechowująca wielomian w postaci rozproszonej.
+ * Wyrazy są posortowane rosnąco według upakowanych wykładników.
+ */
+typedef struct DistPoly {
+    size_t count; ///< liczba wyrazów
+    size_t nvars; ///< liczba zmiennych
+    uint64_t *exps; ///< upakowane wektory wykładników
+    poly_coeff_t *coeffs; ///< niezerowe współczynniki
+} DistPoly;
+
+/**
+ * Sprawdza, czy wielomian da się zapisać w postaci rozproszonej
+ * o @p nvars zmiennych: nie ma dalszych zmiennych, a wykładniki mieszczą
+ * się w polach bez bitów ochronnych.
+ * @param[in] p : wielomian
+ * @param[in] nvars : liczba zmiennych, od 1 do DIST_MAX_VARS
+ * @return Czy wielomian da się zapisać?
+ */
+bool DistFits(const Poly *p, size_t nvars);
+
+/**
+ * Tworzy rozproszoną postać wielomianu. Wielomian musi spełniać DistFits.
+ * @param[in] p : wielomian
+ * @param[in] nvars : liczba zmiennych
+ * @return wielomian w postaci rozproszonej
+ */
+DistPoly DistFromPoly(const Poly *p, size_t nvars);
+
+/**
+ * Odtwarza wielomian z postaci rozproszonej.
+ * @param[in] d : wielomian w postaci rozproszonej
+ * @return wielomian
+ */
+Poly DistToPoly(const DistPoly *d);
+
+/**
+ * Usuwa wielomian w postaci rozproszonej z pamięci.
+ * @param[in] d : wielomian w postaci rozproszonej
+ */
+void DistDestroy(DistPoly *d);
+
+/**
+ * Sprawdza równość dwóch wielomianów w postaci rozproszonej
+ * o tej samej liczbie zmiennych.
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$
+ * @return @f$a = b@f$
+ */
+bool DistIsEq(const DistPoly *a, const DistPoly *b);
+
+/**
+ * Dodaje dwa wielomiany w postaci rozproszonej o tej samej liczbie zmiennych.
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$
+ * @return @f$a + b@f$
+ */
+DistPoly DistAdd(const DistPoly *a, const DistPoly *b);
+
+/**
+ * Sprawdza, czy wykładniki iloczynu zmieszczą się w polach bez bitów ochronnych.
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$ o tej samej liczbie zmiennych
+ * @return Czy iloczyn da się zapisać?
+ */
+bool DistMulFits(const DistPoly *a, const DistPoly *b);
+
+/**
+ * Mnoży dwa wielomiany w postaci rozproszonej spełniające DistMulFits.
+ * Iloczyny wyrazów są scalane kopcem według upakowanych wykładników.
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$
+ * @return @f$a * b@f$
+ */
+DistPoly DistMul(const DistPoly *a, const DistPoly *b);
+
+/**
+ * Wylicza wartość liczbową wielomianu w postaci rozproszonej.
+ * @param[in] d : wielomian w postaci rozproszonej
+ * @param[in] xs : wartości zmiennych, @p d->nvars pozycji
+ * @return wartość wielomianu
+ */
+poly_coeff_t DistEval(const DistPoly *d, const poly_coeff_t xs[]);
+
+/**
+ * Mnoży dwa wielomiany przez postać rozproszoną, jeśli oba czynniki i ich
+ * iloczyn dają się w niej zapisać.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] result : @f$p * q@f$, jeśli się udało
+ * @return Czy iloczyn został policzony?
+ */
+bool DistMulTry(const Poly *p, const Poly *q, Poly *result);
+
+/**
+ * Mnoży dwa wielomiany przez postać rozproszoną, tak jak PolyMul.
+ * Jeśli wielomianów nie da się w niej zapisać, mnoży je przez PolyMul.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p * q@f$
+ */
+Poly DistMulPoly(const Poly *p, const Poly *q);
+
+#endif //DIST_H
@@ -10,6 +10,8 @@
 #include "parser.h"
 #include "poly.h"
 #include "stack.h"
+#include "pool.h"
+#include <assert.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -78,10 +80,8 @@ static void AddCommand(Stack *s, int line_number) {
     if (StackGetSize(s) > 1) {
         Poly first = Pop(s);
         Poly second = Pop(s);
-        Poly sum = PolyAdd(&first, &second);
-        Push(s, &sum);
-        PolyDestroy(&first);
-        PolyDestroy(&second);
+        Poly sum = PolyAddOwn(&first, &second);
+        PushResult(s, &sum);
     } else {
         PrintError(line_number, STACK_UNDERFLOW);
     }
@@ -97,10 +97,8 @@ static void MulCommand(Stack *s, int line_number) {
     if (StackGetSize(s) > 1) {
         Poly first = Pop(s);
         Poly second = Pop(s);
-        Poly mul = PolyMul(&first, &second);
-        Push(s, &mul);
-        PolyDestroy(&first);
-        PolyDestroy(&second);
+        Poly mul = PolyMulOwn(&first, &second);
+        PushResult(s, &mul);
     } else {
         PrintError(line_number, STACK_UNDERFLOW);
     }
@@ -115,9 +113,8 @@ static void MulCommand(Stack *s, int line_number) {
 static void NegCommand(Stack *s, int line_number) {
     if (!StackIsEmpty(s)) {
         Poly p = Pop(s);
-        Poly neg = PolyNeg(&p);
-        Push(s, &neg);
-        PolyDestroy(&p);
+        Poly neg = PolyNegOwn(&p);
+        PushResult(s, &neg);
     } else {
         PrintError(line_number, STACK_UNDERFLOW);
     }
@@ -133,10 +130,8 @@ static void SubCommand(Stack *s, int line_number) {
     if (StackGetSize(s) > 1) {
         Poly first = Pop(s);
         Poly second = Pop(s);
-        Poly sub = PolySub(&first, &second);
-        Push(s, &sub);
-        PolyDestroy(&first);
-        PolyDestroy(&second);
+        Poly sub = PolySubOwn(&first, &second);
+        PushResult(s, &sub);
     } else {
         PrintError(line_number, STACK_UNDERFLOW);
     }
@@ -200,14 +195,56 @@ static void DegByCommand(const Stack *s, int line_number, size_t var_idx) {
 static void AtCommand(Stack *s, int line_number, poly_coeff_t x) {
     if (!StackIsEmpty(s)) {
         Poly p = Pop(s);
-        Poly at = PolyAt(&p, x);
-        Push(s, &at);
+        Poly at = PolyAtOwn(&p, x);
+        PushResult(s, &at);
+    } else {
+        PrintError(line_number, STACK_UNDERFLOW);
+    }
+}
+
+/**
+ * Wykonuje polecenie AT_MANY o podanych parametrach. Modyfikuje stos.
+ * Jeśli wykryje błąd, wypisuje komunikat o błędzie na standardowe wyjście błędów.
+ * @param[in,out] s : stos
+ * @param[in] line_number : numer wiersza, w którym znajduje się polecenie
+ * @param[in] count : liczba punktów
+ * @param[in] xs : tablica punktów
+ */
+static void AtManyCommand(Stack *s, int line_number, size_t count, const poly_coeff_t xs[]) {
+    if (!StackIsEmpty(s)) {
+        Poly p = Pop(s);
+        Poly *at = PoolAlloc(sizeof(Poly) * count);
+        PolyAtMany(&p, count, xs, at);
+        for (size_t i = 0; i < count; ++i) {
+            PushResult(s, &at[i]);
+        }
+        PoolFree(at);
         PolyDestroy(&p);
     } else {
         PrintError(line_number, STACK_UNDERFLOW);
     }
 }
 
+/**
+ * Wykonuje polecenie EVAL o podanych parametrach.
+ * Jeśli wykryje błąd, wypisuje komunikat o błędzie na standardowe wyjście błędów.
+ * @param[in] s : stos
+ * @param[in] line_number : numer wiersza, w którym znajduje się polecenie
+ * @param[in] nvars : liczba wartości zmiennych
+ * @param[in] xs : wartości zmiennych
+ */
+static void EvalCommand(const Stack *s, int line_number, size_t nvars, const poly_coeff_t xs[]) {
+    if (!StackIsEmpty(s)) {
+        Poly p = Top(s);
+        /* kolejne EVAL tego samego wielomianu korzystają z zapamiętanego planu*/
+        poly_coeff_t value;
+        PolyEvalMany(&p, 1, nvars, xs, &value);
+        printf("%ld\n", value);
+    } else {
+        PrintError(line_number, STACK_UNDERFLOW);
+    }
+}
+
 /**
  * Wykonuje polecenie PRINT.
  * Jeśli wykryje błąd, wypisuje komunikat o błędzie na standardowe wyjście błędów.
@@ -257,7 +294,7 @@ static void ComposeCommand(Stack *s, int line_number, size_t k) {
         }
         Poly r = PolyCompose(&p, k, q);
 
-        Push(s, &r);
+        PushResult(s, &r);
 
         PolyDestroy(&p);
         for (size_t i = 0; i < k; ++i) {
@@ -268,6 +305,39 @@ static void ComposeCommand(Stack *s, int line_number, size_t k) {
     }
 }
 
+/**
+ * Wykonuje polecenie ADD_N o podanym parametrze: zdejmuje z wierzchołka stosu
+ * @p k wielomianów i wstawia na stos ich sumę. Modyfikuje stos.
+ * Jeśli wykryje błąd, wypisuje komunikat o błędzie na standardowe wyjście błędów.
+ * @param[in,out] s : stos
+ * @param[in] line_number : numer wiersza, w którym znajduje się polecenie
+ * @param[in] k : liczba sumowanych wielomianów, parser odrzuca @p k = 0
+ */
+static void AddManyCommand(Stack *s, int line_number, size_t k) {
+    assert(k > 0);
+    if (StackGetSize(s) >= k) {
+        Poly *ps = (Poly *) PoolAlloc(sizeof(Poly) * k);
+        for (size_t i = 0; i < k; ++i) {
+            ps[i] = Pop(s);
+        }
+        Poly r = PolyAddMany(k, ps);
+
+        PushResult(s, &r);
+
+        for (size_t i = 0; i < k; ++i) {
+            PolyDestroy(&ps[i]);
+        }
+        PoolFree(ps);
+    } else {
+        PrintError(line_number, STACK_UNDERFLOW);
+    }
+}
+
+void PushResult(Stack *stack, Poly *p) {
+    Poly result = PolyIntern(p);
+    Push(stack, &result);
+}
+
 void ExecuteCommand(Commands command, CommandParams param, Stack *stack, int line_number) {
     switch (command) {
         case ZERO:
@@ -315,6 +385,17 @@ void ExecuteCommand(Commands command, CommandParams param, Stack *stack, int lin
         case COMPOSE:
             ComposeCommand(stack, line_number, param.count);
             break;
+        case AT_MANY:
+            AtManyCommand(stack, line_number, param.points.count, param.points.xs);
+            PoolFree(param.points.xs);
+            break;
+        case EVAL:
+            EvalCommand(stack, line_number, param.points.count, param.points.xs);
+            PoolFree(param.points.xs);
+            break;
+        case ADD_N:
+            AddManyCommand(stack, line_number, param.count);
+            break;
         default:
             break;
     }
@@ -30,7 +30,10 @@ typedef enum Commands {
     AT,
     PRINT,
     POP,
-    COMPOSE
+    COMPOSE,
+    AT_MANY,
+    EVAL,
+    ADD_N
 } Commands;
 
 /**
@@ -38,13 +41,21 @@ typedef enum Commands {
  */
 typedef union CommandParams {
     size_t var_idx; ///< parametr polecenia DEG_BY
-    size_t count; ///< parametr polecenia COMPOSE
+    size_t count; ///< parametr poleceń COMPOSE i ADD_N
     poly_coeff_t x; ///< parametr polecenia AT
+    /**
+     * Parametry poleceń AT_MANY i EVAL.
+     */
+    struct {
+        size_t count; ///< liczba punktów lub wartości zmiennych
+        poly_coeff_t *xs; ///< tablica punktów lub wartości zmiennych
+    } points;
 } CommandParams;
 
 /**
  * Wykonuje polecenie o podanym parametrze. W razie potreby modyfikuje stos.
  * Jeśli wykryje błąd, wypisuje komunikat o błędzie na standardowe wyjście błędów.
+ * Przejmuje na własność tablicę punktów poleceń AT_MANY i EVAL.
  * @param[in] command : polecenie
  * @param[in] param : parametr polecenia
  * @param[in, out] stack : stos
@@ -52,4 +63,14 @@ typedef union CommandParams {
  */
 void ExecuteCommand(Commands command, CommandParams param, Stack *stack, int line_number);
 
+/**
+ * Wstawia na stos wielomian: wynik polecenia albo wczytany wiersz. W trybie
+ * węzłów wspólnych (zob. PolySetHashConsing) węzły wielomianu są najpierw
+ * zastępowane węzłami wspólnymi.
+ * Przejmuje na własność zawartość struktury wskazywanej przez @p p.
+ * @param[in, out] stack : stos
+ * @param[in] p : wielomian
+ */
+void PushResult(Stack *stack, Poly *p);
+
 #endif //EXECUTOR_H
@@ -0,0 +1,248 @@
+/** @file
+  Implementacja spłaszczonej reprezentacji wielomianów
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "flat.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Liczy węzły drzewa wielomianu i jego poziomy.
+ * @param[in] p : wielomian
+ * @param[in] level : poziom wielomianu @p p
+ * @param[in,out] nodes : liczba węzłów
+ * @param[in,out] levels : liczba poziomów
+ */
+static void FlatCount(const Poly *p, size_t level, size_t *nodes, size_t *levels) {
+    (*nodes)++;
+    if (level + 1 > *levels) {
+        *levels = level + 1;
+    }
+    if (PolyIsInline(p)) {
+        /* jednomian bez tablicy ma jedno dziecko, współczynnik*/
+        FlatCount(&(Poly) {.coeff = p->coeff, .arr = NULL}, level + 1, nodes, levels);
+    } else if (!PolyIsCoeff(p)) {
+        for (size_t i = 0; i < p->size; ++i) {
+            FlatCount(&p->arr[i].p, level + 1, nodes, levels);
+        }
+    }
+}
+
+FlatPoly FlatFromPoly(const Poly *p) {
+    FlatPoly f = {.nodes = 0, .levels = 0};
+    FlatCount(p, 0, &f.nodes, &f.levels);
+
+    /* tablice o elementach size_t i poly_coeff_t na początku bloku, wykładniki na końcu*/
+    size_t bytes = sizeof(size_t) * (f.nodes + 1 + f.levels + 1)
+                   + sizeof(poly_coeff_t) * f.nodes
+                   + sizeof(poly_exp_t) * (f.nodes - 1);
+    f.offsets = PoolAlloc(bytes);
+    f.level_starts = f.offsets + f.nodes + 1;
+    f.coeffs = (poly_coeff_t *) (f.level_starts + f.levels + 1);
+    f.exps = (poly_exp_t *) (f.coeffs + f.nodes);
+
+    /* przechodzimy drzewo wszerz, kolejka to kolejne węzły w numeracji*/
+    Poly *queue = PoolAlloc(sizeof(Poly) * f.nodes);
+    queue[0] = *p;
+    size_t entries = 0;
+    for (size_t i = 0; i < f.nodes; ++i) {
+        const Poly *q = &queue[i];
+        f.offsets[i] = entries;
+        if (PolyIsCoeff(q)) {
+            f.coeffs[i] = q->coeff;
+        } else if (PolyIsInline(q)) {
+            f.coeffs[i] = 0;
+            f.exps[entries] = PolyInlineExp(q);
+            queue[++entries] = PolyFromCoeff(q->coeff);
+        } else {
+            f.coeffs[i] = 0;
+            for (size_t j = 0; j < q->size; ++j) {
+                f.exps[entries] = MonoGetExp(&q->arr[j]);
+                /* współczynnik jednomianu o pozycji j to węzeł j + 1*/
+                queue[++entries] = q->arr[j].p;
+            }
+        }
+    }
+    f.offsets[f.nodes] = entries;
+    PoolFree(queue);
+
+    /* dzieci węzłów poziomu zaczynają następny poziom*/
+    f.level_starts[0] = 0;
+    f.level_starts[1] = 1;
+    for (size_t level = 1; level < f.levels; ++level) {
+        f.level_starts[level + 1] = f.offsets[f.level_starts[level]] + 1;
+    }
+    return f;
+}
+
+/**
+ * Odtwarza wielomian z węzła postaci spłaszczonej.
+ * @param[in] f : spłaszczony wielomian
+ * @param[in] node : numer węzła
+ * @return wielomian
+ */
+static Poly FlatToPolyHelper(const FlatPoly *f, size_t node) {
+    size_t begin = f->offsets[node];
+    size_t end = f->offsets[node + 1];
+    if (begin == end) {
+        return PolyFromCoeff(f->coeffs[node]);
+    }
+    Mono *monos = PoolAlloc(sizeof(struct Mono) * (end - begin));
+    for (size_t j = begin; j < end; ++j) {
+        monos[j - begin] = (Mono) {.p = FlatToPolyHelper(f, j + 1), .exp = f->exps[j]};
+    }
+    Poly result = PolyAddMonos(end - begin, monos);
+    PoolFree(monos);
+    return result;
+}
+
+Poly FlatToPoly(const FlatPoly *f) {
+    return FlatToPolyHelper(f, 0);
+}
+
+void FlatDestroy(FlatPoly *f) {
+    PoolFree(f->offsets);
+    f->offsets = NULL;
+}
+
+/**
+ * Sprawdza, czy spłaszczony wielomian jest tożsamościowo równy zeru.
+ * @param[in] f : spłaszczony wielomian
+ * @return Czy wielomian jest równy zeru?
+ */
+static bool FlatIsZero(const FlatPoly *f) {
+    return f->nodes == 1 && f->coeffs[0] == 0;
+}
+
+poly_exp_t FlatDegBy(const FlatPoly *f, size_t var_idx) {
+    if (FlatIsZero(f)) {
+        return -1;
+    }
+    /* wielomian niezerowy ma stopień co najmniej 0 względem każdej zmiennej*/
+    poly_exp_t result = 0;
+    if (var_idx < f->levels) {
+        for (size_t i = f->level_starts[var_idx]; i < f->level_starts[var_idx + 1]; ++i) {
+            /* jednomiany węzła są posortowane, ostatni ma największy wykładnik*/
+            if (f->offsets[i] != f->offsets[i + 1] && f->exps[f->offsets[i + 1] - 1] > result) {
+                result = f->exps[f->offsets[i + 1] - 1];
+            }
+        }
+    }
+    return result;
+}
+
+poly_exp_t FlatDeg(const FlatPoly *f) {
+    if (FlatIsZero(f)) {
+        return -1;
+    }
+    /* dzieci mają większe numery niż rodzice, więc liczymy od końca*/
+    poly_exp_t *degs = PoolAlloc(sizeof(poly_exp_t) * f->nodes);
+    for (size_t i = f->nodes; i-- > 0;) {
+        degs[i] = 0;
+        for (size_t j = f->offsets[i]; j < f->offsets[i + 1]; ++j) {
+            if (f->exps[j] + degs[j + 1] > degs[i]) {
+                degs[i] = f->exps[j] + degs[j + 1];
+            }
+        }
+    }
+    poly_exp_t result = degs[0];
+    PoolFree(degs);
+    return result;
+}
+
+bool FlatIsEq(const FlatPoly *f, const FlatPoly *g) {
+    if (f->nodes != g->nodes) {
+        return false;
+    }
+    return memcmp(f->offsets, g->offsets, sizeof(size_t) * (f->nodes + 1)) == 0
+           && memcmp(f->exps, g->exps, sizeof(poly_exp_t) * (f->nodes - 1)) == 0
+           && memcmp(f->coeffs, g->coeffs, sizeof(poly_coeff_t) * f->nodes) == 0;
+}
+
+/**
+ * Wylicza @f$exp@f$-tą potęgę współczynnika @f$base@f$.
+ * @param[in] base : współczynnik @f$base@f$
+ * @param[in] exp : wykładnik @f$exp@f$
+ * @return @f$base^{exp}@f$
+ */
+static poly_coeff_t FlatPower(poly_coeff_t base, poly_exp_t exp) {
+    poly_coeff_t result = 1;
+    while (exp > 0) {
+        if ((exp & 1) != 0) {
+            result *= base;
+        }
+        exp = exp >> 1;
+        base *= base;
+    }
+    return result;
+}
+
+/**
+ * Wylicza wartość węzła będącego wielomianem zmiennych
+ * @f$x_{var\_idx}, x_{var\_idx + 1}, \ldots@f$.
+ * @param[in] f : spłaszczony wielomian
+ * @param[in] node : numer węzła
+ * @param[in] var_idx : indeks zmiennej węzła
+ * @param[in] nvars : liczba wartości zmiennych
+ * @param[in] xs : wartości zmiennych
+ * @return wartość węzła
+ */
+static poly_coeff_t FlatEvalHelper(const FlatPoly *f, size_t node, size_t var_idx,
+                                   size_t nvars, const poly_coeff_t xs[]) {
+    size_t begin = f->offsets[node];
+    size_t end = f->offsets[node + 1];
+    if (begin == end) {
+        return f->coeffs[node];
+    }
+    poly_coeff_t x = (var_idx < nvars) ? xs[var_idx] : 0;
+    poly_coeff_t result = 0;
+    poly_coeff_t x_power_value = 1;
+    poly_exp_t current_exp = 0;
+    for (size_t j = begin; j < end; ++j) {
+        poly_exp_t previous_exp = current_exp;
+        current_exp = f->exps[j];
+        /* x^m = x^n * x^(m - n)*/
+        x_power_value *= FlatPower(x, current_exp - previous_exp);
+        if (x_power_value == 0) {
+            break;
+        }
+        result += FlatEvalHelper(f, j + 1, var_idx + 1, nvars, xs) * x_power_value;
+    }
+    return result;
+}
+
+poly_coeff_t FlatEval(const FlatPoly *f, size_t nvars, const poly_coeff_t xs[]) {
+    return FlatEvalHelper(f, 0, 0, nvars, xs);
+}
+
+/**
+ * Wypisuje na standardowe wyjście węzeł spłaszczonego wielomianu.
+ * @param[in] f : spłaszczony wielomian
+ * @param[in] node : numer węzła
+ */
+static void FlatPrintHelper(const FlatPoly *f, size_t node) {
+    size_t begin = f->offsets[node];
+    size_t end = f->offsets[node + 1];
+    if (begin == end) {
+        printf("%ld", f->coeffs[node]);
+        return;
+    }
+    for (size_t j = begin; j < end; ++j) {
+        if (j != begin) {
+            printf("+");
+        }
+        printf("(");
+        FlatPrintHelper(f, j + 1);
+        printf(",%d)", f->exps[j]);
+    }
+}
+
+void FlatPrint(const FlatPoly *f) {
+    FlatPrintHelper(f, 0);
+}
@@ -0,0 +1,101 @@
+/** @file
+  Interfejs spłaszczonej reprezentacji wielomianów
+
+  Wielomian w postaci spłaszczonej leży w jednym ciągłym bloku pamięci.
+  Węzły drzewa wielomianu są ponumerowane poziomami (wszerz): korzeń ma
+  numer 0, a dzieci każdego węzła mają kolejne numery. Jednomiany węzła
+  @f$i@f$ to pozycje od @f$offsets_i@f$ do @f$offsets_{i + 1} - 1@f$
+  w tablicy wykładników, a współczynnik jednomianu o pozycji @f$j@f$ to
+  węzeł @f$j + 1@f$. Węzeł bez jednomianów jest współczynnikiem, jego
+  wartość leży w tablicy współczynników. Węzły kolejnych poziomów zajmują
+  spójne przedziały numerów, opisane przez tablicę początków poziomów.
+
+  Postać spłaszczona służy tylko do odczytu. Nadaje się dla wielomianów,
+  które raz zbudowane są potem wyłącznie odpytywane: przechodzenie po niej
+  czyta pamięć po kolei zamiast skakać po osobnych tablicach jednomianów.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef FLAT_H
+#define FLAT_H
+
+#include "poly.h"
+
+/**
+ * To jest struktura przechowująca wielomian w postaci spłaszczonej.
+ * Wszystkie tablice leżą w jednym bloku pamięci zaczynającym się od @p offsets.
+ */
+typedef struct FlatPoly {
+    size_t nodes; ///< liczba węzłów
+    size_t levels; ///< liczba poziomów
+    size_t *offsets; ///< pierwsze jednomiany węzłów, @p nodes + 1 pozycji
+    size_t *level_starts; ///< pierwsze węzły poziomów, @p levels + 1 pozycji
+    poly_coeff_t *coeffs; ///< współczynniki węzłów (0 dla węzłów z jednomianami)
+    poly_exp_t *exps; ///< wykładniki jednomianów, @p nodes - 1 pozycji
+} FlatPoly;
+
+/**
+ * Tworzy spłaszczoną postać wielomianu.
+ * @param[in] p : wielomian
+ * @return spłaszczony wielomian
+ */
+FlatPoly FlatFromPoly(const Poly *p);
+
+/**
+ * Odtwarza wielomian z postaci spłaszczonej.
+ * @param[in] f : spłaszczony wielomian
+ * @return wielomian
+ */
+Poly FlatToPoly(const FlatPoly *f);
+
+/**
+ * Usuwa spłaszczony wielomian z pamięci.
+ * @param[in] f : spłaszczony wielomian
+ */
+void FlatDestroy(FlatPoly *f);
+
+/**
+ * Zwraca stopień wielomianu ze względu na zadaną zmienną, tak jak PolyDegBy.
+ * Przechodzi tylko poziom zmiennej @p var_idx.
+ * @param[in] f : spłaszczony wielomian
+ * @param[in] var_idx : indeks zmiennej
+ * @return stopień wielomianu ze względu na zmienną o indeksie @p var_idx
+ */
+poly_exp_t FlatDegBy(const FlatPoly *f, size_t var_idx);
+
+/**
+ * Zwraca stopień wielomianu, tak jak PolyDeg.
+ * @param[in] f : spłaszczony wielomian
+ * @return stopień wielomianu
+ */
+poly_exp_t FlatDeg(const FlatPoly *f);
+
+/**
+ * Sprawdza równość dwóch spłaszczonych wielomianów. Postać spłaszczona
+ * wielomianu jest jednoznaczna, więc wystarczy porównać tablice.
+ * @param[in] f : spłaszczony wielomian @f$f@f$
+ * @param[in] g : spłaszczony wielomian @f$g@f$
+ * @return @f$f = g@f$
+ */
+bool FlatIsEq(const FlatPoly *f, const FlatPoly *g);
+
+/**
+ * Wylicza wartość liczbową wielomianu, tak jak PolyEval.
+ * Nie przydziela pamięci.
+ * @param[in] f : spłaszczony wielomian
+ * @param[in] nvars : liczba wartości zmiennych
+ * @param[in] xs : wartości zmiennych
+ * @return wartość wielomianu
+ */
+poly_coeff_t FlatEval(const FlatPoly *f, size_t nvars, const poly_coeff_t xs[]);
+
+/**
+ * Wypisuje na standardowe wyjście wielomian, tak jak PolyPrint.
+ * @param[in] f : spłaszczony wielomian
+ */
+void FlatPrint(const FlatPoly *f);
+
+#endif //FLAT_H
@@ -0,0 +1,86 @@
+/** @file
+  Kopiec minimalny o elementach dowolnego typu
+
+  Scalanie list jednomianów w mnożeniu i sumowaniu wielomianów oraz mnożenie
+  w postaci rozproszonej używają tego samego kopca, różniąc się tylko typem
+  elementu. Funkcje są rozwijane w miejscu wywołania ze stałym rozmiarem
+  elementu i stałą funkcją porównującą, więc kompilator może je
+  wyspecjalizować dla każdego typu.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * To jest typ funkcji porównującej elementy kopca.
+ * @param[in] lhs : element
+ * @param[in] rhs : element
+ * @return Czy @p lhs jest mniejszy od @p rhs?
+ */
+typedef bool (*HeapLess)(const void *lhs, const void *rhs);
+
+/**
+ * Wstawia element do kopca minimalnego.
+ * @param[in,out] heap : kopiec, tablica elementów
+ * @param[in,out] size : liczba elementów w kopcu
+ * @param[in] entry_size : rozmiar elementu w bajtach
+ * @param[in] entry : nowy element
+ * @param[in] less : funkcja porównująca elementy
+ */
+static inline void HeapInsert(void *heap, size_t *size, size_t entry_size, const void *entry, HeapLess less) {
+    char *base = (char *) heap;
+    size_t child = (*size)++;
+    while (child > 0) {
+        size_t parent = (child - 1) / 2;
+        if (!less(entry, base + parent * entry_size)) {
+            break;
+        }
+        memcpy(base + child * entry_size, base + parent * entry_size, entry_size);
+        child = parent;
+    }
+    memcpy(base + child * entry_size, entry, entry_size);
+}
+
+/**
+ * Usuwa z kopca minimalnego najmniejszy element. Ostatni element kopca
+ * wędruje w dół na zwolnione miejsce.
+ * @param[in,out] heap : niepusty kopiec, tablica elementów
+ * @param[in,out] size : liczba elementów w kopcu
+ * @param[in] entry_size : rozmiar elementu w bajtach
+ * @param[out] top : usunięty element
+ * @param[in] less : funkcja porównująca elementy
+ */
+static inline void HeapRemove(void *heap, size_t *size, size_t entry_size, void *top, HeapLess less) {
+    assert(*size > 0);
+    char *base = (char *) heap;
+    memcpy(top, base, entry_size);
+    /* ostatni element leży za kopcem, więc przesuwanie go nie nadpisze*/
+    const char *last = base + --(*size) * entry_size;
+    if (*size == 0) {
+        return;
+    }
+    size_t parent = 0;
+    while (2 * parent + 1 < *size) {
+        size_t child = 2 * parent + 1;
+        if (child + 1 < *size && less(base + (child + 1) * entry_size, base + child * entry_size)) {
+            child++;
+        }
+        if (!less(base + child * entry_size, last)) {
+            break;
+        }
+        memcpy(base + parent * entry_size, base + child * entry_size, entry_size);
+        parent = child;
+    }
+    memcpy(base + parent * entry_size, last, entry_size);
+}
+
+#endif //HEAP_H
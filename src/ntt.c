@@ -0,0 +1,346 @@
+/** @file
+  Implementacja mnożenia gęstych ciągów współczynników przez NTT
+
+  Arytmetyka modulo każda z liczb pierwszych jest liczona w postaci
+  Montgomery'ego z @f$R = 2^{64}@f$, dzięki czemu mnożenie modularne nie
+  wymaga dzielenia.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "ntt.h"
+#include "pool.h"
+#include "scheduler.h"
+
+#include <stdint.h>
+
+/** To jest typ iloczynów dwóch liczb 64-bitowych. */
+typedef unsigned __int128 uint128_t;
+
+/** Liczba liczb pierwszych, modulo które liczymy splot */
+#define NTT_PRIMES 3
+/** Logarytm największej długości transformaty, każda liczba pierwsza to @f$c \cdot 2^{40} + 1@f$ */
+#define NTT_MAX_LOG 40
+
+/**
+ * To jest struktura przechowująca liczbę pierwszą postaci @f$c \cdot 2^{40} + 1@f$
+ * i stałe arytmetyki Montgomery'ego modulo ta liczba.
+ */
+typedef struct NttPrime {
+    uint64_t p; ///< liczba pierwsza
+    uint64_t root; ///< pierwiastek pierwotny modulo @p p
+    uint64_t neg_inv; ///< @f$-p^{-1} \bmod 2^{64}@f$
+    uint64_t r2; ///< @f$R^2 \bmod p@f$
+    uint64_t one; ///< jedynka w postaci Montgomery'ego
+    uint64_t omega; ///< pierwiastek z jedynki stopnia @f$2^{40}@f$ w postaci Montgomery'ego
+} NttPrime;
+
+/**
+ * Liczby pierwsze mniejsze niż @f$2^{62}@f$, ich iloczyn przekracza
+ * @f$2^{185}@f$. Stałe Montgomery'ego są liczone przez NttInit.
+ */
+static const NttPrime prime_table[NTT_PRIMES] = {
+    {.p = 4611615649683210241ULL, .root = 11},
+    {.p = 4611613450659954689ULL, .root = 3},
+    {.p = 4611549678985543681ULL, .root = 19},
+};
+
+/**
+ * Redukcja Montgomery'ego.
+ * @param[in] t : liczba mniejsza niż @f$p \cdot R@f$
+ * @param[in] prime : liczba pierwsza
+ * @return @f$t \cdot R^{-1} \bmod p@f$
+ */
+static inline uint64_t NttReduce(uint128_t t, const NttPrime *prime) {
+    uint64_t m = (uint64_t) t * prime->neg_inv;
+    /* p < 2^62, więc suma mieści się w 128 bitach*/
+    uint64_t result = (uint64_t) ((t + (uint128_t) m * prime->p) >> 64);
+    return result >= prime->p ? result - prime->p : result;
+}
+
+/**
+ * Mnoży dwie liczby i dzieli iloczyn przez @f$R@f$. Iloczyn dwóch liczb
+ * w postaci Montgomery'ego jest w tej postaci, a iloczyn liczby zwykłej
+ * i liczby w postaci Montgomery'ego jest liczbą zwykłą.
+ * @param[in] a : liczba mniejsza niż @p p
+ * @param[in] b : liczba mniejsza niż @p p
+ * @param[in] prime : liczba pierwsza
+ * @return @f$a \cdot b \cdot R^{-1} \bmod p@f$
+ */
+static inline uint64_t NttMul(uint64_t a, uint64_t b, const NttPrime *prime) {
+    return NttReduce((uint128_t) a * b, prime);
+}
+
+/**
+ * Zamienia liczbę na postać Montgomery'ego.
+ * @param[in] a : liczba mniejsza niż @p p
+ * @param[in] prime : liczba pierwsza
+ * @return @f$a \cdot R \bmod p@f$
+ */
+static inline uint64_t NttToMont(uint64_t a, const NttPrime *prime) {
+    return NttMul(a, prime->r2, prime);
+}
+
+/**
+ * Redukuje liczbę 64-bitową modulo @p p. Ponieważ @f$p > 2^{61}@f$,
+ * wystarczy kilka odejmowań zamiast dzielenia.
+ * @param[in] a : liczba
+ * @param[in] p : moduł
+ * @return @f$a \bmod p@f$
+ */
+static inline uint64_t NttReduceSmall(uint64_t a, uint64_t p) {
+    while (a >= p) {
+        a -= p;
+    }
+    return a;
+}
+
+/**
+ * Dodaje dwie reszty modulo @p p.
+ * @param[in] a : liczba mniejsza niż @p p
+ * @param[in] b : liczba mniejsza niż @p p
+ * @param[in] p : moduł
+ * @return @f$a + b \bmod p@f$
+ */
+static inline uint64_t NttAdd(uint64_t a, uint64_t b, uint64_t p) {
+    return a + b >= p ? a + b - p : a + b;
+}
+
+/**
+ * Odejmuje dwie reszty modulo @p p.
+ * @param[in] a : liczba mniejsza niż @p p
+ * @param[in] b : liczba mniejsza niż @p p
+ * @param[in] p : moduł
+ * @return @f$a - b \bmod p@f$
+ */
+static inline uint64_t NttSub(uint64_t a, uint64_t b, uint64_t p) {
+    return a >= b ? a - b : a + p - b;
+}
+
+/**
+ * Podnosi liczbę w postaci Montgomery'ego do potęgi.
+ * @param[in] base : podstawa w postaci Montgomery'ego
+ * @param[in] exp : wykładnik
+ * @param[in] prime : liczba pierwsza
+ * @return @f$base^{exp}@f$ w postaci Montgomery'ego
+ */
+static uint64_t NttPow(uint64_t base, uint64_t exp, const NttPrime *prime) {
+    uint64_t result = prime->one;
+    while (exp > 0) {
+        if ((exp & 1) != 0) {
+            result = NttMul(result, base, prime);
+        }
+        exp = exp >> 1;
+        base = NttMul(base, base, prime);
+    }
+    return result;
+}
+
+/**
+ * Daje odwrotność liczby z małego twierdzenia Fermata.
+ * @param[in] a : niezerowa liczba w postaci Montgomery'ego
+ * @param[in] prime : liczba pierwsza
+ * @return @f$a^{-1}@f$ w postaci Montgomery'ego
+ */
+static uint64_t NttInverse(uint64_t a, const NttPrime *prime) {
+    return NttPow(a, prime->p - 2, prime);
+}
+
+/**
+ * Liczy stałe Montgomery'ego liczb pierwszych. Koszt jest pomijalny wobec
+ * transformaty, a lokalna kopia nie wymaga synchronizacji.
+ * @param[out] primes : liczby pierwsze ze stałymi
+ */
+static void NttInit(NttPrime primes[NTT_PRIMES]) {
+    for (size_t i = 0; i < NTT_PRIMES; ++i) {
+        NttPrime *prime = &primes[i];
+        *prime = prime_table[i];
+        uint64_t p = prime->p;
+        /* metoda Newtona podwaja liczbę poprawnych bitów odwrotności*/
+        uint64_t inv = p;
+        for (int step = 0; step < 5; ++step) {
+            inv *= 2 - p * inv;
+        }
+        prime->neg_inv = 0 - inv;
+        prime->one = (0 - p) % p;
+        prime->r2 = (uint64_t) ((uint128_t) prime->one * prime->one % p);
+        prime->omega = NttPow(NttToMont(prime->root, prime), (p - 1) >> NTT_MAX_LOG, prime);
+    }
+}
+
+size_t NttLength(size_t count) {
+    size_t length = 1;
+    while (length < count) {
+        length = length << 1;
+    }
+    return length;
+}
+
+/**
+ * Wypełnia tablicę pierwiastków z jedynki dla wszystkich poziomów transformaty:
+ * pozycje od @f$h@f$ do @f$2h - 1@f$ to kolejne potęgi pierwiastka stopnia @f$2h@f$.
+ * @param[out] twiddles : tablica o @p length wyrazach
+ * @param[in] length : długość transformaty, potęga dwójki
+ * @param[in] prime : liczba pierwsza
+ */
+static void NttTwiddles(uint64_t twiddles[], size_t length, const NttPrime *prime) {
+    /* pierwiastek stopnia length przez podnoszenie omegi do kwadratu*/
+    uint64_t root = prime->omega;
+    for (size_t k = length; k < ((size_t) 1 << NTT_MAX_LOG); k = k << 1) {
+        root = NttMul(root, root, prime);
+    }
+    for (size_t half = length >> 1; half > 0; half = half >> 1) {
+        uint64_t w = prime->one;
+        for (size_t j = 0; j < half; ++j) {
+            twiddles[half + j] = w;
+            w = NttMul(w, root, prime);
+        }
+        root = NttMul(root, root, prime);
+    }
+}
+
+/**
+ * Przekształca w miejscu ciąg w postaci Montgomery'ego transformatą NTT.
+ * Transformata odwrotna (bez dzielenia przez długość) to ta sama transformata
+ * z odwróconą kolejnością wyrazów od drugiego do ostatniego.
+ * @param[in,out] a : ciąg
+ * @param[in] length : długość ciągu, potęga dwójki
+ * @param[in] twiddles : pierwiastki z jedynki z NttTwiddles
+ * @param[in] prime : liczba pierwsza
+ */
+static void NttTransform(uint64_t a[], size_t length, const uint64_t twiddles[], const NttPrime *prime) {
+    uint64_t p = prime->p;
+    for (size_t i = 1, j = 0; i < length; ++i) {
+        size_t bit = length >> 1;
+        for (; (j & bit) != 0; bit = bit >> 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            uint64_t tmp = a[i];
+            a[i] = a[j];
+            a[j] = tmp;
+        }
+    }
+    for (size_t half = 1; half < length; half = half << 1) {
+        const uint64_t *w = twiddles + half;
+        for (size_t i = 0; i < length; i += 2 * half) {
+            for (size_t j = 0; j < half; ++j) {
+                uint64_t u = a[i + j];
+                uint64_t v = NttMul(a[i + j + half], w[j], prime);
+                a[i + j] = NttAdd(u, v, p);
+                a[i + j + half] = NttSub(u, v, p);
+            }
+        }
+    }
+}
+
+/**
+ * Liczy splot modulo jedna liczba pierwsza.
+ * @param[in] n : długość ciągu @p a
+ * @param[in] a : ciąg @f$a@f$
+ * @param[in] m : długość ciągu @p b
+ * @param[in] b : ciąg @f$b@f$
+ * @param[in] length : długość transformaty
+ * @param[in] prime : liczba pierwsza
+ * @param[out] work : tablica robocza o @f$3 \cdot length@f$ wyrazach
+ * @param[out] residues : reszty splotu, @f$n + m - 1@f$ wyrazów
+ */
+static void NttConvolveMod(size_t n, const poly_coeff_t a[], size_t m, const poly_coeff_t b[],
+                           size_t length, const NttPrime *prime, uint64_t work[], uint64_t residues[]) {
+    uint64_t p = prime->p;
+    uint64_t *fa = work;
+    uint64_t *fb = work + length;
+    uint64_t *twiddles = work + 2 * length;
+    NttTwiddles(twiddles, length, prime);
+    for (size_t i = 0; i < length; ++i) {
+        fa[i] = i < n ? NttToMont(NttReduceSmall((uint64_t) a[i], p), prime) : 0;
+    }
+    NttTransform(fa, length, twiddles, prime);
+    if (a == b && n == m) {
+        /* kwadrat: transformata drugiego czynnika jest taka sama*/
+        fb = fa;
+    } else {
+        for (size_t i = 0; i < length; ++i) {
+            fb[i] = i < m ? NttToMont(NttReduceSmall((uint64_t) b[i], p), prime) : 0;
+        }
+        NttTransform(fb, length, twiddles, prime);
+    }
+    for (size_t i = 0; i < length; ++i) {
+        fa[i] = NttMul(fa[i], fb[i], prime);
+    }
+    NttTransform(fa, length, twiddles, prime);
+    /* 1/length w postaci zwykłej: mnożenie od razu wyprowadza wynik z postaci Montgomery'ego*/
+    uint64_t length_inv = NttReduce(NttInverse(NttToMont(length, prime), prime), prime);
+    residues[0] = NttMul(fa[0], length_inv, prime);
+    for (size_t k = 1; k < n + m - 1; ++k) {
+        residues[k] = NttMul(fa[length - k], length_inv, prime);
+    }
+}
+
+/**
+ * To jest struktura opisująca sploty modulo kolejne liczby pierwsze.
+ */
+typedef struct NttJob {
+    size_t n; ///< długość ciągu @p a
+    const poly_coeff_t *a; ///< ciąg @f$a@f$
+    size_t m; ///< długość ciągu @p b
+    const poly_coeff_t *b; ///< ciąg @f$b@f$
+    size_t length; ///< długość transformaty
+    const NttPrime *primes; ///< liczby pierwsze
+    uint64_t *work; ///< tablice robocze kolejnych splotów
+    size_t work_stride; ///< odstęp między tablicami roboczymi, 0 jeśli tablica jest wspólna
+    uint64_t *residues; ///< reszty kolejnych splotów, każde po @f$n + m - 1@f$ wyrazów
+} NttJob;
+
+/**
+ * Liczy splot modulo jedna z liczb pierwszych.
+ * @param[in,out] arg : sploty
+ * @param[in] index : numer liczby pierwszej
+ */
+static void NttConvolveJob(void *arg, size_t index) {
+    NttJob *job = arg;
+    NttConvolveMod(job->n, job->a, job->m, job->b, job->length, &job->primes[index],
+                   job->work + index * job->work_stride, job->residues + index * (job->n + job->m - 1));
+}
+
+void NttConvolve(size_t n, const poly_coeff_t a[], size_t m, const poly_coeff_t b[], poly_coeff_t c[]) {
+    NttPrime primes[NTT_PRIMES];
+    NttInit(primes);
+    size_t count = n + m - 1;
+    size_t length = NttLength(count);
+    /* na wielu wątkach każda liczba pierwsza dostaje własną tablicę roboczą*/
+    size_t work_count = (SchedulerThreads() > 1) ? NTT_PRIMES : 1;
+    uint64_t *work = PoolAlloc(sizeof(uint64_t) * (work_count * 3 * length + NTT_PRIMES * count));
+    uint64_t *residues = work + work_count * 3 * length;
+    NttJob job = {.n = n, .a = a, .m = m, .b = b, .length = length, .primes = primes,
+                  .work = work, .work_stride = (work_count > 1) ? 3 * length : 0, .residues = residues};
+    SchedulerParallelFor(NTT_PRIMES, NttConvolveJob, &job);
+
+    /* algorytm Garnera: x = v1 + v2 * p1 + v3 * p1 * p2, gdzie vi < pi;
+     * stałe w postaci Montgomery'ego, więc NttMul z liczbą zwykłą daje liczbę zwykłą*/
+    const NttPrime *prime2 = &primes[1];
+    const NttPrime *prime3 = &primes[2];
+    uint64_t p1 = primes[0].p;
+    uint64_t p2 = prime2->p;
+    uint64_t p3 = prime3->p;
+    uint64_t p1_mont_p2 = NttToMont(NttReduceSmall(p1, p2), prime2);
+    uint64_t p1_mont_p3 = NttToMont(NttReduceSmall(p1, p3), prime3);
+    uint64_t p2_mont_p3 = NttToMont(NttReduceSmall(p2, p3), prime3);
+    uint64_t p1_inv_p2 = NttInverse(p1_mont_p2, prime2);
+    uint64_t p1p2_inv_p3 = NttInverse(NttMul(p1_mont_p3, p2_mont_p3, prime3), prime3);
+    for (size_t k = 0; k < count; ++k) {
+        uint64_t v1 = residues[k];
+        uint64_t r2 = residues[count + k];
+        uint64_t r3 = residues[2 * count + k];
+        uint64_t v2 = NttMul(NttSub(r2, NttReduceSmall(v1, p2), p2), p1_inv_p2, prime2);
+        uint64_t partial = NttAdd(NttReduceSmall(v1, p3),
+                                  NttMul(NttReduceSmall(v2, p3), p1_mont_p3, prime3), p3);
+        uint64_t v3 = NttMul(NttSub(r3, partial, p3), p1p2_inv_p3, prime3);
+        /* obliczenia modulo 2^64 dają wynik z przepełnieniem jak w poly_coeff_t*/
+        c[k] = (poly_coeff_t) (v1 + v2 * p1 + v3 * (p1 * p2));
+    }
+    PoolFree(work);
+}
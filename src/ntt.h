@@ -0,0 +1,41 @@
+/** @file
+  Interfejs mnożenia gęstych ciągów współczynników przez NTT
+
+  Splot jest liczony teoretycznoliczbową transformatą Fouriera (NTT) modulo
+  trzy liczby pierwsze mniejsze niż @f$2^{62}@f$, a wynik jest odtwarzany
+  z chińskiego twierdzenia o resztach. Iloczyn trzech liczb pierwszych
+  przekracza największą możliwą wartość splotu, więc wynik jest dokładny
+  modulo @f$2^{64}@f$, czyli taki sam jak przy mnożeniu i dodawaniu
+  współczynników z przepełnieniem.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef NTT_H
+#define NTT_H
+
+#include "poly.h"
+
+/**
+ * Daje długość transformaty potrzebną do splotu ciągu o @p count wyrazach:
+ * najmniejszą potęgę dwójki nie mniejszą niż @p count.
+ * @param[in] count : długość splotu
+ * @return długość transformaty
+ */
+size_t NttLength(size_t count);
+
+/**
+ * Liczy splot dwóch ciągów współczynników:
+ * @f$c_k = \sum_{i + j = k} a_i b_j@f$ z przepełnieniem jak w typie
+ * poly_coeff_t. Ciągi mogą być tą samą tablicą.
+ * @param[in] n : długość ciągu @p a
+ * @param[in] a : ciąg @f$a@f$
+ * @param[in] m : długość ciągu @p b
+ * @param[in] b : ciąg @f$b@f$
+ * @param[out] c : splot, tablica o @f$n + m - 1@f$ wyrazach
+ */
+void NttConvolve(size_t n, const poly_coeff_t a[], size_t m, const poly_coeff_t b[], poly_coeff_t c[]);
+
+#endif //NTT_H
@@ -6,10 +6,14 @@
   @date 2021
 */
 
+/* mmap, fstat i read są częścią POSIX, a nie C11*/
+#define _POSIX_C_SOURCE 200809L
+
 #include "parser.h"
 #include "poly.h"
 #include "executor.h"
 #include "vector.h"
+#include "pool.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -17,6 +21,9 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /** Maksymalna długość(ilość znaków) polecenia(bez parametrów) */
 #define COMMAND_MAX_LENGTH 8
@@ -34,6 +41,8 @@
 #define PARTLY_READ *end_ptr != '\0'
 /** Baza dziesiętna */
 #define DECIMAL_BASE 10
+/** Rozmiar bufora wejścia, gdy standardowego wejścia nie da się zmapować */
+#define INPUT_BUFFER_SIZE (1 << 16)
 
 /**
  * Typ wielomianu
@@ -63,25 +72,124 @@ void PrintError(int line_number, Errors error) {
         case WRONG_PARAMETER:
             fprintf(stderr, "ERROR %d COMPOSE WRONG PARAMETER\n", line_number);
             break;
+        case WRONG_POINTS:
+            fprintf(stderr, "ERROR %d AT_MANY WRONG VALUE\n", line_number);
+            break;
+        case WRONG_EVAL_VALUE:
+            fprintf(stderr, "ERROR %d EVAL WRONG VALUE\n", line_number);
+            break;
+        case WRONG_ADD_N_PARAMETER:
+            fprintf(stderr, "ERROR %d ADD_N WRONG PARAMETER\n", line_number);
+            break;
         default:
             break;
     }
 }
 
+/**
+ * To jest struktura przechowująca wejście parsera. Jeśli standardowe wejście
+ * jest zwykłym plikiem, cały plik jest zmapowany do pamięci. W przeciwnym
+ * razie wejście jest czytane dużymi kawałkami do bufora. Znaki od @p pos
+ * do @p end czekają na przetworzenie.
+ */
+typedef struct Input {
+    const char *pos; ///< następny znak
+    const char *end; ///< koniec wczytanych znaków
+    char *data; ///< bufor lub zmapowany plik, NULL przed pierwszym odczytem
+    size_t mapped; ///< rozmiar zmapowanego pliku lub 0, jeśli wejście jest czytane do bufora
+    bool eof; ///< Czy wejście się skończyło?
+} Input;
+
+/** Wejście parsera */
+static Input input = {0};
+
+/**
+ * Mapuje standardowe wejście do pamięci, jeśli jest zwykłym niepustym plikiem.
+ * Dane zaczynają się od bieżącej pozycji w pliku.
+ * @return Czy udało się zmapować wejście?
+ */
+static bool InputMap(void) {
+    struct stat info;
+    if (fstat(STDIN_FILENO, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {
+        return false;
+    }
+    off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (offset < 0 || offset >= info.st_size) {
+        return false;
+    }
+    void *data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    posix_madvise(data, (size_t) info.st_size, POSIX_MADV_SEQUENTIAL);
+    input.data = data;
+    input.mapped = (size_t) info.st_size;
+    input.pos = input.data + offset;
+    input.end = input.data + input.mapped;
+    return true;
+}
+
+/**
+ * Uzupełnia wejście, gdy wszystkie wczytane znaki zostały przetworzone.
+ * Przy pierwszym wywołaniu mapuje standardowe wejście, a jeśli się nie da,
+ * przydziela bufor. Zmapowany plik jest wczytany od razu w całości.
+ * @return Czy są nowe znaki? Jeśli nie, wejście się skończyło.
+ */
+static bool InputFill(void) {
+    if (input.eof) {
+        return false;
+    }
+    if (input.data == NULL) {
+        if (InputMap()) {
+            return true;
+        }
+        input.data = (char *) PoolAlloc(INPUT_BUFFER_SIZE);
+    }
+    if (input.mapped == 0) {
+        ssize_t count;
+        do {
+            count = read(STDIN_FILENO, input.data, INPUT_BUFFER_SIZE);
+        } while (count < 0 && errno == EINTR);
+        if (count > 0) {
+            input.pos = input.data;
+            input.end = input.data + count;
+            return true;
+        }
+    }
+    input.eof = true;
+    return false;
+}
+
+/**
+ * Pobiera następny znak wejścia. Po końcu wejścia zwraca zawsze EOF.
+ * @return następny znak w sekwencji wejścia lub EOF
+ */
+static inline int GetChar(void) {
+    return (input.pos < input.end || InputFill()) ? (unsigned char) *input.pos++ : EOF;
+}
+
+void ParserDestroy() {
+    if (input.mapped > 0) {
+        munmap(input.data, input.mapped);
+    } else {
+        PoolFree(input.data);
+    }
+    input = (Input) {0};
+}
+
 void SkipLine() {
-    int c;
-    do {
-        c = getchar();
-    } while (c != '\n' && c != EOF);
-    if (c == EOF) {
-        ungetc(c, stdin);
+    while (input.pos < input.end || InputFill()) {
+        const char *newline = memchr(input.pos, '\n', (size_t) (input.end - input.pos));
+        if (newline != NULL) {
+            input.pos = newline + 1;
+            return;
+        }
+        input.pos = input.end;
     }
 }
 
 int PeekChar() {
-    int next = getchar();
-    ungetc(next, stdin);
-    return next;
+    return (input.pos < input.end || InputFill()) ? (unsigned char) *input.pos : EOF;
 }
 
 /**
@@ -96,9 +204,6 @@ static bool IsPolyEnd(int c, PolyType type) {
     switch (type) {
         case OUTER:
             result = (c == '\n' || c == EOF);
-            if (c == EOF) {
-                ungetc(c, stdin);
-            }
             break;
         case INNER:
             result = (c == ',');
@@ -111,8 +216,8 @@ static bool IsPolyEnd(int c, PolyType type) {
 
 /**
  * Przetwarza wiersz ze standardowego wejśćia i zwraca wartość parametru polecenia DEG_BY.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza),
+ * następne wywołanie PeekChar zwraca EOF.
  * @param[out] var_idx : wartość parametru polecenia DEG_BY
  * @return Czy się udało sparsować wiersz?
  */
@@ -125,7 +230,7 @@ static bool ParseVariable(size_t *var_idx) {
 
         /* pomijamy zera */
         bool find_zero = false;
-        while ((c = getchar()) == '0') {
+        while ((c = GetChar()) == '0') {
             find_zero = true;
         }
         /* pojedyncze zero */
@@ -138,16 +243,12 @@ static bool ParseVariable(size_t *var_idx) {
         while (i < NUMBER_MAX_LENGTH && isdigit(c)) {
             line[i] = (char) c;
             i++;
-            c = getchar();
+            c = GetChar();
         }
         line[i] = '\0';
 
         /* cała liczba wczytana*/
         if (c == '\n' || c == EOF) {
-            if (c == EOF) {
-                ungetc(c, stdin);
-            }
-
             char *end_ptr;
             errno = 0;
             unsigned long long result;
@@ -173,8 +274,8 @@ static bool ParseVariable(size_t *var_idx) {
 
 /**
  * Przetwarza wiersz ze standardowego wejśćia i zwraca wartość parametru polecenia AT.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza),
+ * następne wywołanie PeekChar zwraca EOF.
  * @param[out] x : wartość parametru polecenia AT
  * @return Czy się udało sparsować wiersz?
  */
@@ -186,13 +287,13 @@ static bool ParseValue(poly_coeff_t *x) {
         int c;
 
         if (PeekChar() == '-') {
-            line[i] = (char) getchar();
+            line[i] = (char) GetChar();
             i++;
         }
 
         /* pomijamy zera */
         bool find_zero = false;
-        while ((c = getchar()) == '0') {
+        while ((c = GetChar()) == '0') {
             find_zero = true;
         }
         /* pojedyncze zero */
@@ -205,16 +306,12 @@ static bool ParseValue(poly_coeff_t *x) {
         while (i < NUMBER_MAX_LENGTH && isdigit(c)) {
             line[i] = (char) c;
             i++;
-            c = getchar();
+            c = GetChar();
         }
         line[i] = '\0';
 
         /* cała liczba wczytana*/
         if (c == '\n' || c == EOF) {
-            if (c == EOF) {
-                ungetc(c, stdin);
-            }
-
             char *end_ptr;
             errno = 0;
             long result;
@@ -239,6 +336,90 @@ static bool ParseValue(poly_coeff_t *x) {
 
 }
 
+/** Początkowa pojemność tablicy punktów polecenia AT_MANY */
+#define POINTS_INIT_CAPACITY 4
+
+/**
+ * Przetwarza wiersz ze standardowego wejśćia i zwraca wartości parametrów
+ * polecenia AT_MANY: liczby oddzielone pojedynczymi spacjami. Jeśli się udało,
+ * wołający otrzymuje tablicę @p xs na własność.
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza),
+ * następne wywołanie PeekChar zwraca EOF.
+ * @param[out] count : liczba wartości
+ * @param[out] xs : tablica wartości
+ * @return Czy się udało sparsować wiersz?
+ */
+static bool ParseValues(size_t *count, poly_coeff_t **xs) {
+    size_t capacity = POINTS_INIT_CAPACITY;
+    *count = 0;
+    *xs = (poly_coeff_t *) PoolAlloc(sizeof(poly_coeff_t) * capacity);
+    bool correct = true;
+    int c = ' ';
+    while (correct && c == ' ') {
+        /* liczba nie może się zaczynać od + */
+        if (PeekChar() == '+') {
+            correct = false;
+            break;
+        }
+        char line[NUMBER_MAX_LENGTH + 1];
+        int i = 0;
+
+        if (PeekChar() == '-') {
+            line[i] = (char) GetChar();
+            i++;
+        }
+
+        /* pomijamy zera */
+        bool find_zero = false;
+        while ((c = GetChar()) == '0') {
+            find_zero = true;
+        }
+        /* pojedyncze zero */
+        if (find_zero && (c == ' ' || c == '\n' || c == EOF)) {
+            line[i] = '0';
+            i++;
+        }
+
+        /* wczytujemy liczbę */
+        while (i < NUMBER_MAX_LENGTH && isdigit(c)) {
+            line[i] = (char) c;
+            i++;
+            c = GetChar();
+        }
+        line[i] = '\0';
+
+        /* cała liczba wczytana*/
+        if (c == ' ' || c == '\n' || c == EOF) {
+            char *end_ptr;
+            errno = 0;
+            long result;
+            result = strtol(line, &end_ptr, DECIMAL_BASE);
+            if (ERROR || NO_MATCH || PARTLY_READ) {
+                correct = false;
+            } else {
+                if (*count == capacity) {
+                    capacity *= 2;
+                    *xs = (poly_coeff_t *) PoolRealloc(*xs, sizeof(poly_coeff_t) * capacity);
+                }
+                (*xs)[(*count)++] = result;
+            }
+        }
+        /* przekroczenie max długośći lub błędny znak */
+        else {
+            correct = false;
+        }
+    }
+
+    if (c != EOF && c != '\n') {
+        SkipLine();
+    }
+    if (!correct) {
+        PoolFree(*xs);
+        *xs = NULL;
+    }
+    return correct;
+}
+
 bool ParseCommand(int line_number, Commands *command, CommandParams *param) {
     char line[COMMAND_MAX_LENGTH + 1];
     memset(line,'0',COMMAND_MAX_LENGTH);
@@ -246,19 +427,15 @@ bool ParseCommand(int line_number, Commands *command, CommandParams *param) {
     int i = 0;
     int c;
 
-    c = getchar();
+    c = GetChar();
     while (i < COMMAND_MAX_LENGTH && (isupper(c) || c == '_')) {
         line[i] = (char) c;
         i++;
-        c = getchar();
+        c = GetChar();
     }
     line[i] = '\0';
 
     if (c == '\n' || c == EOF) {
-        if (c == EOF) {
-            ungetc(c, stdin);
-        }
-
         if (strcmp(line, "ZERO") == 0) {
             *command = ZERO;
         } else if (strcmp(line, "IS_COEFF") == 0) {
@@ -292,6 +469,15 @@ bool ParseCommand(int line_number, Commands *command, CommandParams *param) {
         } else if (strcmp(line, "COMPOSE") == 0) {
             PrintError(line_number, WRONG_PARAMETER);
             return false;
+        } else if (strcmp(line, "AT_MANY") == 0) {
+            PrintError(line_number, WRONG_POINTS);
+            return false;
+        } else if (strcmp(line, "EVAL") == 0) {
+            PrintError(line_number, WRONG_EVAL_VALUE);
+            return false;
+        } else if (strcmp(line, "ADD_N") == 0) {
+            PrintError(line_number, WRONG_ADD_N_PARAMETER);
+            return false;
         } else {
             PrintError(line_number, WRONG_COMMAND);
             return false;
@@ -315,6 +501,27 @@ bool ParseCommand(int line_number, Commands *command, CommandParams *param) {
                 PrintError(line_number, WRONG_PARAMETER);
                 return false;
             }
+        } else if (strcmp(line, "AT_MANY") == 0) {
+            *command = AT_MANY;
+            if (!ParseValues(&param->points.count, &param->points.xs) || c != ' ') {
+                PoolFree(param->points.xs);
+                PrintError(line_number, WRONG_POINTS);
+                return false;
+            }
+        } else if (strcmp(line, "EVAL") == 0) {
+            *command = EVAL;
+            if (!ParseValues(&param->points.count, &param->points.xs) || c != ' ') {
+                PoolFree(param->points.xs);
+                PrintError(line_number, WRONG_EVAL_VALUE);
+                return false;
+            }
+        } else if (strcmp(line, "ADD_N") == 0) {
+            *command = ADD_N;
+            /* suma zera wielomianów nie ma sensu, więc k = 0 jest błędem*/
+            if (!ParseVariable(&param->count) || c != ' ' || param->count == 0) {
+                PrintError(line_number, WRONG_ADD_N_PARAMETER);
+                return false;
+            }
         } else {
             PrintError(line_number, WRONG_COMMAND);
             SkipLine();
@@ -326,8 +533,8 @@ bool ParseCommand(int line_number, Commands *command, CommandParams *param) {
 
 /**
  * Przetwarza wiersz ze standardowego wejśćia i zwraca wartość współczynnika jednomianu.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza),
+ * następne wywołanie PeekChar zwraca EOF.
  * @param[out] coeff : wartość współczynnika jednomianu
  * @param[in] type : typ wielomianu
  * @return Czy się udało sparsować wiersz?
@@ -340,13 +547,13 @@ static bool ParseCoeff(poly_coeff_t *coeff, PolyType type) {
         int c;
 
         if (PeekChar() == '-') {
-            line[i] = (char) getchar();
+            line[i] = (char) GetChar();
             i++;
         }
 
         /* pomijamy zera */
         bool find_zero = false;
-        while ((c = getchar()) == '0') {
+        while ((c = GetChar()) == '0') {
             find_zero = true;
         }
         /* pojedyncze zero */
@@ -359,7 +566,7 @@ static bool ParseCoeff(poly_coeff_t *coeff, PolyType type) {
         while (i < NUMBER_MAX_LENGTH && isdigit(c)) {
             line[i] = (char) c;
             i++;
-            c = getchar();
+            c = GetChar();
         }
         line[i] = '\0';
 
@@ -384,8 +591,6 @@ static bool ParseCoeff(poly_coeff_t *coeff, PolyType type) {
         else {
             if (c != EOF && c != '\n') {
                 SkipLine();
-            } else if (c == EOF) {
-                ungetc(c, stdin);
             }
             return false;
         }
@@ -399,8 +604,8 @@ static bool ParseCoeff(poly_coeff_t *coeff, PolyType type) {
  * Przetwarza wiersz ze standardowego wejśćia i zwraca wielomian.
  * Jeśli wykryje błąd, wypisuje komunikat o błędzie
  * na standardowe wyjście błędów i zwraca false.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza),
+ * następne wywołanie PeekChar zwraca EOF.
  * @param[in] line_number : numer wiersza, w którym znajduje się błąd
  * @param[out] poly : wielomian
  * @param[in] type : typ wielomianu
@@ -427,11 +632,11 @@ static bool ParsePolyHelper(int line_number, Poly *poly, PolyType type) {
                 int ch = PeekChar();
                 if (ch == '+') {
                     /* wczytujemy następny jednomian */
-                    ch = getchar();
+                    ch = GetChar();
                     end = false;
                 } else if (IsPolyEnd(ch, type)) {
                     /* ostatni jednomian został wczytany */
-                    ch = getchar();
+                    ch = GetChar();
                     end = true;
                 } else {
                     SkipLine();
@@ -448,7 +653,7 @@ static bool ParsePolyHelper(int line_number, Poly *poly, PolyType type) {
         }
         *poly = PolyAddMonos(v.size, v.array);
         /* poly jest właścicielem jednomianów z wektora */
-        free(v.array);
+        VectorRelease(&v);
         return true;
     } else {
         SkipLine();
@@ -460,8 +665,8 @@ static bool ParsePolyHelper(int line_number, Poly *poly, PolyType type) {
 
 /**
  * Przetwarza wiersz ze standardowego wejśćia i zwraca wartość wykładnika jednomianu.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza),
+ * następne wywołanie PeekChar zwraca EOF.
  * @param[out] exp : wartość wykładnika jednomianu
  * @return Czy się udało sparsować wiersz?
  */
@@ -474,7 +679,7 @@ static bool ParseExp(poly_exp_t *exp) {
 
         /* pomijamy zera */
         bool find_zero = false;
-        while ((c = getchar()) == '0') {
+        while ((c = GetChar()) == '0') {
             find_zero = true;
         }
         /* pojedyncze zero */
@@ -487,7 +692,7 @@ static bool ParseExp(poly_exp_t *exp) {
         while (i < EXP_MAX_LENGTH && isdigit(c)) {
             line[i] = (char) c;
             i++;
-            c = getchar();
+            c = GetChar();
         }
         line[i] = '\0';
 
@@ -509,8 +714,6 @@ static bool ParseExp(poly_exp_t *exp) {
         else {
             if (c != EOF && c != '\n') {
                 SkipLine();
-            } else if (c == EOF) {
-                ungetc(c, stdin);
             }
             return false;
         }
@@ -523,7 +726,7 @@ static bool ParseExp(poly_exp_t *exp) {
 bool ParseMono(int line_number, Mono *mono) {
     int c = PeekChar();
     if (c == '(') {
-        c = getchar();
+        c = GetChar();
         Poly poly;
         if (ParsePolyHelper(line_number, &poly, INNER)) {
             /* , wczytany w ParsePolyHelper */
@@ -22,18 +22,31 @@ typedef enum Errors {
     WRONG_VALUE,
     STACK_UNDERFLOW,
     WRONG_POLY,
-    WRONG_PARAMETER
+    WRONG_PARAMETER,
+    WRONG_POINTS,
+    WRONG_EVAL_VALUE,
+    WRONG_ADD_N_PARAMETER
 } Errors;
 
 /**
- * Odczytuje następny znak bez pobierania go.
- * @return następny znak w sekwencji wejścia
+ * Odczytuje następny znak bez pobierania go. Standardowe wejście jest
+ * mapowane do pamięci, jeśli jest zwykłym plikiem, a w przeciwnym razie
+ * czytane dużymi kawałkami do bufora, więc parser przegląda znaki
+ * bezpośrednio w pamięci, bez wywołań stdio dla każdego znaku.
+ * @return następny znak w sekwencji wejścia lub EOF, jeśli wejście się skończyło
  */
 int PeekChar();
 
 /**
- * Pomija biezący wiersz. Jeśli nie ma więcej wierszów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Zwalnia bufor wejścia albo zmapowany plik.
+ */
+void ParserDestroy();
+
+/**
+ * Pomija biezący wiersz razem ze znakiem końca wiersza, szukając go
+ * bezpośrednio w zmapowanym pliku albo w buforze wejścia (kawałki po 64 KiB).
+ * Jeśli wiersz kończy się końcem wejścia (EOF na końcu wiersza), koniec
+ * wejścia jest trwały: kolejne wywołania PeekChar zwracają EOF.
  */
 void SkipLine();
 
@@ -48,8 +61,10 @@ void PrintError(int line_number, Errors error);
  * Przetwarza wiersz ze standardowego wejśćia. Zwraca polecenie
  * i parametry polecenia. Jeśli wykryje błąd, wypisuje komunikat o błędzie
  * na standardowe wyjście błędów i zwraca false.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Znaki są czytane ze zmapowanego pliku albo z bufora wejścia, więc nic nie
+ * jest zwracane do strumienia. Jeśli wiersz kończy się końcem wejścia
+ * (EOF na końcu wiersza), koniec wejścia jest trwały i następne wywołanie
+ * PeekChar zwraca EOF.
  * @param[in] line_number : numer wiersza, w którym znajduje się błąd
  * @param[out] command : polecenie
  * @param[out] param : parametr polecenia
@@ -61,8 +76,10 @@ bool ParseCommand(int line_number, Commands *command, CommandParams *param);
  * Przetwarza wiersz ze standardowego wejśćia i zwraca wielomian.
  * Jeśli wykryje błąd, wypisuje komunikat o błędzie
  * na standardowe wyjście błędów i zwraca false.
- * Jeśli nie ma więcej znakówów do odczytania
- * (EOF na końcu wiersza), umieszcza EOF z powrotem w strumieniu wejściowym.
+ * Znaki są czytane ze zmapowanego pliku albo z bufora wejścia, więc nic nie
+ * jest zwracane do strumienia. Jeśli wiersz kończy się końcem wejścia
+ * (EOF na końcu wiersza), koniec wejścia jest trwały i następne wywołanie
+ * PeekChar zwraca EOF.
  * @param[in] line_number : numer wiersza, w którym znajduje się błąd
  * @param[out] poly : wielomian
  * @return Czy się udało sparsować wiersz?
@@ -0,0 +1,302 @@
+/** @file
+  Implementacja skompilowanych planów wyliczania wartości wielomianu
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "plan.h"
+#include "pool.h"
+
+#include <stdint.h>
+
+/** Liczba punktów, na których naraz działa każda instrukcja planu */
+#define PLAN_BATCH 64
+/** Początkowa pojemność tablic instrukcji i kroków */
+#define PLAN_INIT_CAPACITY 16
+/** Oznaczenie pustego miejsca w tablicy mieszającej kroków */
+#define PLAN_NO_STEP SIZE_MAX
+
+/**
+ * Instrukcje maszyny stosowej wykonującej plan.
+ * @f$top@f$ to wartość na wierzchołku stosu, a @f$pow@f$ to potęga
+ * zmiennej wskazana przez krok instrukcji.
+ */
+typedef enum PlanOp {
+    PLAN_PUSH, ///< wstawia na stos współczynnik
+    PLAN_MUL, ///< @f$top := top \cdot pow@f$
+    PLAN_HORNER, ///< @f$top := top \cdot pow + coeff@f$
+    PLAN_MUL_ADD ///< zdejmuje @f$b@f$ ze stosu, @f$top := top \cdot pow + b@f$
+} PlanOp;
+
+/**
+ * Instrukcja planu.
+ */
+typedef struct PlanInstr {
+    PlanOp op; ///< rodzaj instrukcji
+    size_t step; ///< indeks kroku w tablicy kroków planu
+    poly_coeff_t coeff; ///< współczynnik instrukcji PLAN_PUSH i PLAN_HORNER
+} PlanInstr;
+
+/**
+ * Krok wykładnika: potęga zmiennej, przez którą mnożą instrukcje.
+ */
+typedef struct PlanStep {
+    size_t var_idx; ///< indeks zmiennej
+    poly_exp_t exp; ///< wykładnik
+} PlanStep;
+
+/**
+ * Skompilowany plan wyliczania wartości wielomianu.
+ */
+struct PolyPlan {
+    PlanInstr *code; ///< instrukcje
+    size_t size; ///< liczba instrukcji
+    PlanStep *steps; ///< różne kroki wykładników używane przez instrukcje
+    size_t steps_count; ///< liczba kroków
+    size_t depth; ///< największa głębokość stosu w czasie wykonania
+};
+
+/**
+ * Stan kompilacji planu.
+ */
+typedef struct PlanBuilder {
+    PolyPlan *plan; ///< budowany plan
+    size_t code_capacity; ///< pojemność tablicy instrukcji
+    size_t steps_capacity; ///< pojemność tablicy kroków
+    size_t *table; ///< tablica mieszająca indeksów kroków
+    size_t table_capacity; ///< pojemność tablicy mieszającej, potęga dwójki
+    size_t depth; ///< bieżąca głębokość stosu
+} PlanBuilder;
+
+/**
+ * Wylicza @f$exp@f$-tą potęgę współczynnika @f$base@f$.
+ * @param[in] base : współczynnik @f$base@f$
+ * @param[in] exp : wykładnik @f$exp@f$
+ * @return @f$base^{exp}@f$
+ */
+static poly_coeff_t PlanPower(poly_coeff_t base, poly_exp_t exp) {
+    poly_coeff_t result = 1;
+    while (exp > 0) {
+        if ((exp & 1) != 0) {
+            result *= base;
+        }
+        exp = exp >> 1;
+        base *= base;
+    }
+    return result;
+}
+
+/**
+ * Wyznacza miejsce kroku w tablicy mieszającej.
+ * @param[in] var_idx : indeks zmiennej
+ * @param[in] exp : wykładnik
+ * @param[in] capacity : pojemność tablicy mieszającej, potęga dwójki
+ * @return początkowe miejsce kroku
+ */
+static size_t StepHash(size_t var_idx, poly_exp_t exp, size_t capacity) {
+    uint64_t hash = (uint64_t) var_idx * 0x9E3779B97F4A7C15u ^ (uint64_t) exp * 0xC2B2AE3D27D4EB4Fu;
+    return (size_t) (hash ^ (hash >> 29)) & (capacity - 1);
+}
+
+/**
+ * Wstawia indeks kroku do tablicy mieszającej.
+ * @param[in,out] b : stan kompilacji
+ * @param[in] step : indeks kroku
+ */
+static void StepInsert(PlanBuilder *b, size_t step) {
+    const PlanStep *s = &b->plan->steps[step];
+    size_t pos = StepHash(s->var_idx, s->exp, b->table_capacity);
+    while (b->table[pos] != PLAN_NO_STEP) {
+        pos = (pos + 1) & (b->table_capacity - 1);
+    }
+    b->table[pos] = step;
+}
+
+/**
+ * Daje indeks kroku o podanej zmiennej i wykładniku,
+ * dodając krok do planu, jeśli jeszcze go nie ma.
+ * @param[in,out] b : stan kompilacji
+ * @param[in] var_idx : indeks zmiennej
+ * @param[in] exp : wykładnik
+ * @return indeks kroku
+ */
+static size_t StepIndex(PlanBuilder *b, size_t var_idx, poly_exp_t exp) {
+    PolyPlan *plan = b->plan;
+    size_t pos = StepHash(var_idx, exp, b->table_capacity);
+    while (b->table[pos] != PLAN_NO_STEP) {
+        const PlanStep *s = &plan->steps[b->table[pos]];
+        if (s->var_idx == var_idx && s->exp == exp) {
+            return b->table[pos];
+        }
+        pos = (pos + 1) & (b->table_capacity - 1);
+    }
+    if (plan->steps_count == b->steps_capacity) {
+        b->steps_capacity *= 2;
+        plan->steps = PoolRealloc(plan->steps, sizeof(PlanStep) * b->steps_capacity);
+    }
+    size_t step = plan->steps_count++;
+    plan->steps[step] = (PlanStep) {.var_idx = var_idx, .exp = exp};
+    /* tablica mieszająca jest zapełniona co najwyżej w połowie*/
+    if (2 * plan->steps_count > b->table_capacity) {
+        PoolFree(b->table);
+        b->table_capacity *= 2;
+        b->table = PoolAlloc(sizeof(size_t) * b->table_capacity);
+        for (size_t i = 0; i < b->table_capacity; ++i) {
+            b->table[i] = PLAN_NO_STEP;
+        }
+        for (size_t i = 0; i < plan->steps_count; ++i) {
+            StepInsert(b, i);
+        }
+    } else {
+        b->table[pos] = step;
+    }
+    return step;
+}
+
+/**
+ * Dopisuje instrukcję na koniec planu i uaktualnia głębokość stosu.
+ * @param[in,out] b : stan kompilacji
+ * @param[in] op : rodzaj instrukcji
+ * @param[in] step : indeks kroku
+ * @param[in] coeff : współczynnik
+ */
+static void PlanAppend(PlanBuilder *b, PlanOp op, size_t step, poly_coeff_t coeff) {
+    PolyPlan *plan = b->plan;
+    if (plan->size == b->code_capacity) {
+        b->code_capacity *= 2;
+        plan->code = PoolRealloc(plan->code, sizeof(PlanInstr) * b->code_capacity);
+    }
+    plan->code[plan->size++] = (PlanInstr) {.op = op, .step = step, .coeff = coeff};
+    if (op == PLAN_PUSH) {
+        b->depth++;
+        if (b->depth > plan->depth) {
+            plan->depth = b->depth;
+        }
+    } else if (op == PLAN_MUL_ADD) {
+        b->depth--;
+    }
+}
+
+/**
+ * Dopisuje do planu instrukcje, które wstawiają na stos wartość wielomianu
+ * zmiennych @f$x_{var\_idx}, x_{var\_idx + 1}, \ldots@f$. Jednomiany są
+ * przechodzone schematem Hornera od największego wykładnika.
+ * @param[in,out] b : stan kompilacji
+ * @param[in] p : wielomian
+ * @param[in] var_idx : indeks zmiennej wielomianu @p p
+ */
+static void PlanEmit(PlanBuilder *b, const Poly *p, size_t var_idx) {
+    if (PolyIsCoeff(p)) {
+        PlanAppend(b, PLAN_PUSH, 0, p->coeff);
+        return;
+    }
+    if (PolyIsInline(p)) {
+        PlanAppend(b, PLAN_PUSH, 0, p->coeff);
+        PlanAppend(b, PLAN_MUL, StepIndex(b, var_idx, PolyInlineExp(p)), 0);
+        return;
+    }
+    PlanEmit(b, &p->arr[p->size - 1].p, var_idx + 1);
+    for (size_t i = p->size - 1; i > 0; --i) {
+        const Mono *m = &p->arr[i - 1];
+        size_t step = StepIndex(b, var_idx, MonoGetExp(&p->arr[i]) - MonoGetExp(m));
+        if (PolyIsCoeff(&m->p)) {
+            PlanAppend(b, PLAN_HORNER, step, m->p.coeff);
+        } else {
+            PlanEmit(b, &m->p, var_idx + 1);
+            PlanAppend(b, PLAN_MUL_ADD, step, 0);
+        }
+    }
+    if (MonoGetExp(&p->arr[0]) > 0) {
+        PlanAppend(b, PLAN_MUL, StepIndex(b, var_idx, MonoGetExp(&p->arr[0])), 0);
+    }
+}
+
+PolyPlan *PlanCompile(const Poly *p) {
+    PolyPlan *plan = PoolAlloc(sizeof(PolyPlan));
+    plan->code = PoolAlloc(sizeof(PlanInstr) * PLAN_INIT_CAPACITY);
+    plan->size = 0;
+    plan->steps = PoolAlloc(sizeof(PlanStep) * PLAN_INIT_CAPACITY);
+    plan->steps_count = 0;
+    plan->depth = 0;
+
+    PlanBuilder b = {
+            .plan = plan,
+            .code_capacity = PLAN_INIT_CAPACITY,
+            .steps_capacity = PLAN_INIT_CAPACITY,
+            .table = PoolAlloc(sizeof(size_t) * 2 * PLAN_INIT_CAPACITY),
+            .table_capacity = 2 * PLAN_INIT_CAPACITY,
+            .depth = 0
+    };
+    for (size_t i = 0; i < b.table_capacity; ++i) {
+        b.table[i] = PLAN_NO_STEP;
+    }
+    PlanEmit(&b, p, 0);
+    PoolFree(b.table);
+    return plan;
+}
+
+void PlanDestroy(PolyPlan *plan) {
+    if (plan != NULL) {
+        PoolFree(plan->code);
+        PoolFree(plan->steps);
+        PoolFree(plan);
+    }
+}
+
+void PlanEval(const PolyPlan *plan, size_t n, size_t nvars, const poly_coeff_t xs[], poly_coeff_t out[]) {
+    poly_coeff_t *powers = PoolAlloc(sizeof(poly_coeff_t) * PLAN_BATCH * plan->steps_count);
+    poly_coeff_t *stack = PoolAlloc(sizeof(poly_coeff_t) * PLAN_BATCH * plan->depth);
+    for (size_t start = 0; start < n; start += PLAN_BATCH) {
+        size_t count = (n - start < PLAN_BATCH) ? n - start : PLAN_BATCH;
+        /* potęgi dla wszystkich kroków liczymy raz na blok punktów*/
+        for (size_t s = 0; s < plan->steps_count; ++s) {
+            const PlanStep *step = &plan->steps[s];
+            poly_coeff_t *power = powers + s * PLAN_BATCH;
+            for (size_t k = 0; k < count; ++k) {
+                poly_coeff_t x = (step->var_idx < nvars) ? xs[(start + k) * nvars + step->var_idx] : 0;
+                power[k] = PlanPower(x, step->exp);
+            }
+        }
+        /* na stosie leżą bloki po PLAN_BATCH wartości, po jednej dla każdego punktu*/
+        size_t stack_size = 0;
+        for (size_t i = 0; i < plan->size; ++i) {
+            const PlanInstr *instr = &plan->code[i];
+            if (instr->op == PLAN_PUSH) {
+                stack_size++;
+            } else if (instr->op == PLAN_MUL_ADD) {
+                stack_size--;
+            }
+            poly_coeff_t *top = stack + (stack_size - 1) * PLAN_BATCH;
+            const poly_coeff_t *power = powers + instr->step * PLAN_BATCH;
+            switch (instr->op) {
+                case PLAN_PUSH:
+                    for (size_t k = 0; k < count; ++k) {
+                        top[k] = instr->coeff;
+                    }
+                    break;
+                case PLAN_MUL:
+                    for (size_t k = 0; k < count; ++k) {
+                        top[k] *= power[k];
+                    }
+                    break;
+                case PLAN_HORNER:
+                    for (size_t k = 0; k < count; ++k) {
+                        top[k] = top[k] * power[k] + instr->coeff;
+                    }
+                    break;
+                case PLAN_MUL_ADD:
+                    for (size_t k = 0; k < count; ++k) {
+                        top[k] = top[k] * power[k] + top[k + PLAN_BATCH];
+                    }
+                    break;
+            }
+        }
+        for (size_t k = 0; k < count; ++k) {
+            out[start + k] = stack[k];
+        }
+    }
+    PoolFree(powers);
+    PoolFree(stack);
+}
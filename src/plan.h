@@ -0,0 +1,48 @@
+/** @file
+  Interfejs skompilowanych planów wyliczania wartości wielomianu
+
+  Plan to drzewo wielomianu spłaszczone do liniowego programu dla maszyny
+  stosowej. Każdy węzeł jest liczony schematem Hornera, a różnice kolejnych
+  wykładników są zebrane w tablicy kroków, więc potęgi zmiennych liczy się
+  raz na cały blok punktów. Wykonanie planu nie przechodzi już po wskaźnikach
+  drzewa, a każda instrukcja działa naraz na całym bloku punktów.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "poly.h"
+
+/** Skompilowany plan wyliczania wartości wielomianu */
+typedef struct PolyPlan PolyPlan;
+
+/**
+ * Kompiluje wielomian nie stały do planu.
+ * @param[in] p : wielomian nie stały
+ * @return plan, wołający otrzymuje go na własność
+ */
+PolyPlan *PlanCompile(const Poly *p);
+
+/**
+ * Usuwa plan z pamięci. Jeśli @p plan jest równy NULL, nic nie robi.
+ * @param[in] plan : plan
+ */
+void PlanDestroy(PolyPlan *plan);
+
+/**
+ * Wykonuje plan dla @p n punktów, tak jak PolyEval dla każdego punktu.
+ * Wartości zmiennych @p k-tego punktu to @p xs[k * nvars], ...,
+ * @p xs[k * nvars + nvars - 1].
+ * @param[in] plan : plan
+ * @param[in] n : liczba punktów
+ * @param[in] nvars : liczba wartości zmiennych w punkcie
+ * @param[in] xs : wartości zmiennych kolejnych punktów
+ * @param[out] out : wartości wielomianu w kolejnych punktach
+ */
+void PlanEval(const PolyPlan *plan, size_t n, size_t nvars, const poly_coeff_t xs[], poly_coeff_t out[]);
+
+#endif //PLAN_H
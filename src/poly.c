@@ -6,28 +6,331 @@
   @date 2021
 */
 #include "poly.h"
+#include "dist.h"
+#include "heap.h"
+#include "ntt.h"
+#include "plan.h"
+#include "pool.h"
+#include "scheduler.h"
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-/**
- * Kod zakończenia.
- * Jeśli wystąpi błąd krytyczny, np. zabraknie pamięci, program powinien zakończyć się awaryjnie kodem 1.
-*/
-#define ERROR_EXIT_STATUS 1
 /** Minimalna wartość wykładnika wielomianu */
 #define EXP_MIN (-1)
+/** Liczba zadań przypadających na jeden wątek przy dzieleniu operacji między wątki */
+#define TASKS_PER_THREAD 4
+/** Najmniejsza liczba jednomianów na dwóch najwyższych poziomach, od której operacja dzieli pracę na zadania */
+#define TASK_MIN_MONOS 4096
+/** Początkowa wartość skrótu wielomianu nie stałego */
+#define HASH_SEED UINT64_C(0x6a09e667f3bcc908)
+/** Początkowa liczba kubełków tablicy węzłów wspólnych */
+#define INTERN_MIN_BUCKETS 1024
+/** Najmniejszy iloczyn liczb wyrazów czynników, od którego PolyMul może liczyć w postaci rozproszonej */
+#define DIST_MUL_MIN_PAIRS 4096
+/** Początkowa liczba kubełków pamięci podręcznej wyników */
+#define RESULT_MIN_BUCKETS 64
+/** Największa liczba jednomianów sortowana przez wstawianie */
+#define SORT_INSERTION_MAX 32
+/** Największa liczba posortowanych serii, które są scalane zamiast sortowania pozycyjnego */
+#define SORT_MERGE_MAX_RUNS 16
+/** Liczba bitów cyfry w sortowaniu pozycyjnym */
+#define RADIX_BITS 8
+/** Liczba wartości cyfry w sortowaniu pozycyjnym */
+#define RADIX_SIZE (1 << RADIX_BITS)
+/** Liczba cyfr wykładnika w sortowaniu pozycyjnym */
+#define RADIX_DIGITS ((int) (sizeof(poly_exp_t) * CHAR_BIT / RADIX_BITS))
+
+
+/**
+ * Nagłówek tablicy jednomianów. Tablica jednomianów wielomianu nie stałego
+ * leży w tym samym bloku pamięci tuż za nagłówkiem. Kopie wielomianu
+ * współdzielą tablicę (i przez nią całe poddrzewo), a licznik referencji
+ * mówi, ilu właścicieli ją ma. Tablicę wolno modyfikować tylko wtedy,
+ * gdy ma jednego właściciela. Nagłówek przechowuje też skompilowany plan
+ * wyliczania wartości poddrzewa i dane o poddrzewie (zob. PolyMeta),
+ * usuwane przy modyfikacji tablicy.
+ * Licznik jest atomowy, bo kopie tego samego poddrzewa mogą powstawać
+ * i znikać jednocześnie w kilku wątkach. Z tego samego powodu plan i dane
+ * o poddrzewie są zapisywane atomowo: zostaje tylko pierwszy zapisany.
+ */
+typedef struct MonosHeader {
+    atomic_size_t refcount; ///< liczba wielomianów współdzielących tablicę
+    PolyPlan *_Atomic plan; ///< plan wyliczania wartości lub NULL, jeśli jeszcze nie powstał
+    struct PolyMeta *_Atomic meta; ///< dane o poddrzewie lub NULL, jeśli jeszcze nie powstały
+} MonosHeader;
+
+/**
+ * Dane o poddrzewie wielomianu liczone przy pierwszej potrzebie z danych
+ * poddrzew współczynników. Niezmienione poddrzewa wyników operacji są
+ * współdzielone razem ze swoimi danymi, więc dla nowego wielomianu liczone
+ * są tylko dane nowych węzłów.
+ */
+typedef struct PolyMeta {
+    poly_exp_t deg; ///< stopień wielomianu
+    size_t terms; ///< liczba niezerowych wyrazów, czyli liści drzewa
+    size_t bytes; ///< łączny rozmiar tablic jednomianów poddrzewa w bajtach
+    size_t vars; ///< liczba zmiennych, czyli głębokość drzewa
+    uint64_t hash; ///< skrót struktury wielomianu (zob. PolyHash)
+    atomic_bool interned; ///< Czy węzeł jest w tablicy węzłów wspólnych (zob. PolyIntern)?
+    poly_exp_t degs[]; ///< stopnie ze względu na kolejne zmienne, @p vars pozycji
+} PolyMeta;
+
+/**
+ * Daje nagłówek tablicy jednomianów wielomianu nie stałego.
+ * @param[in] p : wielomian nie stały
+ * @return nagłówek tablicy jednomianów
+ */
+static MonosHeader *PolyHeader(const Poly *p) {
+    return (MonosHeader *) p->arr - 1;
+}
+
+/**
+ * Przydziela tablicę jednomianów z nagłówkiem. Tablica ma jednego właściciela.
+ * @param[in] count : liczba jednomianów
+ * @return tablica jednomianów
+ */
+static Mono *MonosAlloc(size_t count) {
+    MonosHeader *header = (MonosHeader *) PoolAlloc(sizeof(MonosHeader) + sizeof(struct Mono) * count);
+    atomic_init(&header->refcount, 1);
+    atomic_init(&header->plan, NULL);
+    atomic_init(&header->meta, NULL);
+    return (Mono *) (header + 1);
+}
+
+/**
+ * Zmienia pojemność tablicy jednomianów przydzielonej przez MonosAlloc.
+ * Tablica musi mieć jednego właściciela.
+ * @param[in] arr : tablica jednomianów
+ * @param[in] count : nowa liczba jednomianów
+ * @return tablica jednomianów o nowej pojemności
+ */
+static Mono *MonosRealloc(Mono *arr, size_t count) {
+    MonosHeader *header = (MonosHeader *) arr - 1;
+    assert(header->refcount == 1);
+    header = (MonosHeader *) PoolRealloc(header, sizeof(MonosHeader) + sizeof(struct Mono) * count);
+    return (Mono *) (header + 1);
+}
+
+/**
+ * Widok jednomianu zapisanego bez tablicy (zob. PolyIsInline) jako zwykłego
+ * wielomianu z jednoelementową tablicą jednomianów. Widok leży w pamięci
+ * wołającego i służy tylko do odczytu, dzięki czemu funkcje przechodzące
+ * tablice jednomianów nie muszą rozróżniać obu zapisów. Licznik referencji
+ * równy 0 odróżnia widok od tablic przydzielonych przez MonosAlloc.
+ */
+typedef struct PolyView {
+    MonosHeader header; ///< nagłówek tablicy, licznik referencji jest równy 0
+    Mono mono; ///< jedyny jednomian, leży tuż za nagłówkiem
+    Poly poly; ///< wielomian, którego tablicą jest @p mono
+} PolyView;
+
+/**
+ * Daje wielomian, którego jednomiany można przechodzić w tablicy. Jeśli
+ * wielomian jest jednomianem zapisanym bez tablicy, wypełnia jego widok.
+ * @param[in] p : wielomian nie stały
+ * @param[out] view : miejsce na widok
+ * @return @p p albo widok wielomianu @p p
+ */
+static const Poly *PolyViewOf(const Poly *p, PolyView *view) {
+    if (!PolyIsInline(p)) {
+        return p;
+    }
+    atomic_init(&view->header.refcount, 0);
+    atomic_init(&view->header.plan, NULL);
+    atomic_init(&view->header.meta, NULL);
+    view->mono = (Mono) {.p = PolyFromCoeff(p->coeff), .exp = PolyInlineExp(p)};
+    view->poly = (Poly) {.size = 1, .arr = &view->mono};
+    return &view->poly;
+}
+
+/**
+ * Sprawdza, czy wielomian ma tablicę jednomianów (nie jest współczynnikiem
+ * ani jednomianem zapisanym bez tablicy).
+ * @param[in] p : wielomian
+ * @return Czy wielomian ma tablicę jednomianów?
+ */
+static bool PolyHasMonos(const Poly *p) {
+    return !PolyIsCoeff(p) && !PolyIsInline(p);
+}
+
+/**
+ * Zwalnia tablicę jednomianów przydzieloną przez MonosAlloc,
+ * nie usuwając samych jednomianów.
+ * @param[in] arr : tablica jednomianów
+ */
+static void MonosFree(Mono *arr) {
+    MonosHeader *header = (MonosHeader *) arr - 1;
+    PlanDestroy(atomic_load(&header->plan));
+    PoolFree(atomic_load(&header->meta));
+    PoolFree(header);
+}
+
+/**
+ * Daje liczbę zadań, na które dzielimy przejście @p count jednomianów.
+ * @param[in] count : liczba jednomianów
+ * @return liczba zadań, co najwyżej @p count
+ */
+static size_t TaskCount(size_t count) {
+    size_t tasks = SchedulerThreads() * TASKS_PER_THREAD;
+    return (tasks < count) ? tasks : count;
+}
+
+/**
+ * Sprawdza, czy operację przechodzącą jednomiany wielomianu opłaca się
+ * podzielić na zadania: jest kilka wątków, a dwa najwyższe poziomy drzewa
+ * mają co najmniej TASK_MIN_MONOS jednomianów. Jeśli dane o poddrzewie są
+ * już policzone, decyduje rozmiar całego poddrzewa. Mniejsze poddrzewa są
+ * przechodzone w bieżącym wątku.
+ * @param[in] p : wielomian z tablicą jednomianów
+ * @return Czy dzielić operację na zadania?
+ */
+static bool PolyUseTasks(const Poly *p) {
+    if (SchedulerThreads() <= 1 || p->size < 2) {
+        return false;
+    }
+    const PolyMeta *meta = atomic_load(&PolyHeader(p)->meta);
+    if (meta != NULL) {
+        return meta->bytes >= TASK_MIN_MONOS * sizeof(struct Mono);
+    }
+    size_t monos = p->size;
+    for (size_t i = 0; i < p->size && monos < TASK_MIN_MONOS; ++i) {
+        const Poly *coeff = &p->arr[i].p;
+        monos += (!PolyIsCoeff(coeff) && !PolyIsInline(coeff)) ? coeff->size : 1;
+    }
+    return monos >= TASK_MIN_MONOS;
+}
+
+/**
+ * To jest struktura opisująca tablicę jednomianów podzieloną na zadania.
+ */
+typedef struct MonosTasks {
+    Mono *arr; ///< tablica jednomianów
+    size_t size; ///< liczba jednomianów
+    size_t count; ///< liczba zadań
+} MonosTasks;
+
+/**
+ * Usuwa z pamięci jednomiany z jednego przedziału tablicy.
+ * @param[in,out] arg : tablica jednomianów podzielona na zadania
+ * @param[in] index : numer zadania
+ */
+static void DestroyTask(void *arg, size_t index) {
+    MonosTasks *tasks = arg;
+    for (size_t i = tasks->size * index / tasks->count; i < tasks->size * (index + 1) / tasks->count; ++i) {
+        MonoDestroy(&tasks->arr[i]);
+    }
+}
+
+/**
+ * To jest struktura przechowująca wpis tablicy węzłów wspólnych.
+ * Wpis nie jest liczony w liczniku referencji tablicy jednomianów:
+ * usunięcie ostatniej kopii węzła usuwa też jego wpis.
+ */
+typedef struct InternEntry {
+    Poly poly; ///< węzeł
+    uint64_t hash; ///< skrót węzła
+    struct InternEntry *next; ///< następny wpis w kubełku
+} InternEntry;
+
+/** Czy PolyIntern ma zastępować węzły wspólnymi? */
+static atomic_bool hash_consing = false;
+/** Chroni tablicę węzłów wspólnych i zejście do zera liczników referencji jej węzłów */
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+/** Kubełki tablicy węzłów wspólnych */
+static InternEntry **intern_buckets = NULL;
+/** Liczba kubełków, potęga dwójki */
+static size_t intern_capacity = 0;
+/** Liczba węzłów w tablicy */
+static size_t intern_count = 0;
+
+/**
+ * Sprawdza, czy tablica jednomianów wielomianu jest w tablicy węzłów wspólnych.
+ * @param[in] p : wielomian
+ * @return Czy węzeł jest wspólny?
+ */
+static bool PolyIsInterned(const Poly *p) {
+    if (!PolyHasMonos(p)) {
+        return false;
+    }
+    const PolyMeta *meta = atomic_load(&PolyHeader(p)->meta);
+    return meta != NULL && atomic_load(&meta->interned);
+}
+
+/**
+ * Usuwa węzeł z tablicy węzłów wspólnych. Wymaga blokady intern_lock.
+ * @param[in] p : wspólny węzeł
+ */
+static void InternRemove(const Poly *p) {
+    PolyMeta *meta = atomic_load(&PolyHeader(p)->meta);
+    InternEntry **entry = &intern_buckets[meta->hash & (intern_capacity - 1)];
+    while ((*entry)->poly.arr != p->arr) {
+        entry = &(*entry)->next;
+    }
+    InternEntry *removed = *entry;
+    *entry = removed->next;
+    PoolFree(removed);
+    intern_count--;
+    atomic_store(&meta->interned, false);
+}
+
+/**
+ * Usuwa referencję do wspólnego węzła. Zejście licznika do zera i usunięcie
+ * wpisu odbywają się pod blokadą, aby nikt nie znalazł usuwanego węzła.
+ * @param[in] p : wspólny węzeł
+ * @return Czy była to ostatnia referencja?
+ */
+static bool InternRelease(const Poly *p) {
+    pthread_mutex_lock(&intern_lock);
+    bool last = (--PolyHeader(p)->refcount == 0);
+    if (last) {
+        InternRemove(p);
+    }
+    pthread_mutex_unlock(&intern_lock);
+    return last;
+}
 
+/**
+ * Przygotowuje węzeł o jednym właścicielu do modyfikacji w miejscu: jeśli
+ * jest wspólny, usuwa go z tablicy węzłów wspólnych.
+ * @param[in] p : węzeł
+ * @return Czy węzeł nadal ma jednego właściciela i można go modyfikować?
+ */
+static bool InternForget(const Poly *p) {
+    if (!PolyIsInterned(p)) {
+        return true;
+    }
+    pthread_mutex_lock(&intern_lock);
+    /* inny wątek mógł w międzyczasie znaleźć węzeł w tablicy*/
+    bool unique = (PolyHeader(p)->refcount == 1);
+    if (unique) {
+        InternRemove(p);
+    }
+    pthread_mutex_unlock(&intern_lock);
+    return unique;
+}
 
 void PolyDestroy(Poly *p) {
-    if (!PolyIsCoeff(p)) {
-        for (size_t i = 0; i < p->size; ++i) {
-            MonoDestroy(&p->arr[i]);
+    if (PolyHasMonos(p)) {
+        assert(PolyHeader(p)->refcount > 0);
+        /* tablica jest współdzielona, usuwamy tylko naszą referencję*/
+        if (PolyIsInterned(p) ? InternRelease(p) : --PolyHeader(p)->refcount == 0) {
+            if (PolyUseTasks(p)) {
+                MonosTasks tasks = {.arr = p->arr, .size = p->size, .count = TaskCount(p->size)};
+                SchedulerParallelFor(tasks.count, DestroyTask, &tasks);
+            } else {
+                for (size_t i = 0; i < p->size; ++i) {
+                    MonoDestroy(&p->arr[i]);
+                }
+            }
+            MonosFree(p->arr);
         }
-        free(p->arr);
-        p->arr = NULL;
     }
+    p->arr = NULL;
 }
 
 /**
@@ -36,37 +339,50 @@ void PolyDestroy(Poly *p) {
  * @return nowy wielomian
  */
 static Poly PolyInit(size_t size) {
-    Mono *init_arr = (Mono *) malloc(sizeof(struct Mono) * size);
-    if (init_arr == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
-    return (Poly) {.size = size, .arr = init_arr};
+    return (Poly) {.size = size, .arr = MonosAlloc(size)};
 }
 
 Poly PolyClone(const Poly *p) {
-    if (PolyIsCoeff(p)) {
-        /* tutaj zostanie zwrócona kopia *p*/
-        return *p;
-    } else {
-        Poly new_poly = PolyInit(p->size);
-        for (size_t i = 0; i < p->size; ++i) {
-            new_poly.arr[i] = MonoClone(&p->arr[i]);
+    if (PolyHasMonos(p)) {
+        if (PolyHeader(p)->refcount == 0) {
+            /* kopia widoku to jednomian zapisany bez tablicy*/
+            return PolyFromInline(p->arr[0].p.coeff, MonoGetExp(&p->arr[0]));
         }
-        return new_poly;
+        /* kopia współdzieli tablicę jednomianów z oryginałem*/
+        PolyHeader(p)->refcount++;
     }
+    return *p;
 }
 
 /**
- * Porównuje dwa jenomiany według wykładników.
- * @param[in] lhs : wskaźnik na jednomian
- * @param[in] rhs : wskaźnik na jednomian
- * @return wynik porównania:
- *        - dodatnia wartość całkowita, jeśli pierwszy argument jest większy niż drugi,
- *        - ujemna wartość całkowita, jeśli pierwszy argument jest mniejszy niż drugi,
- *        - zero, jeśli argumenty są równoważne
+ * Zapewnia, że wielomian nie stały jest jedynym właścicielem swojej tablicy
+ * jednomianów, tak aby można ją było modyfikować. Jeśli tablica jest
+ * współdzielona, zastępuje ją płytką kopią: jednomiany kopii współdzielą
+ * współczynniki z oryginałem. Plan wyliczania wartości i dane o poddrzewie
+ * przestają być aktualne, więc są usuwane, a wspólny węzeł znika z tablicy
+ * węzłów wspólnych. Jednomian zapisany bez tablicy dostaje własną
+ * jednoelementową tablicę.
+ * @param[in,out] p : wielomian nie stały
  */
-static poly_exp_t MonoCompare(const void *lhs, const void *rhs) {
-    return ((Mono *) lhs)->exp - ((Mono *) rhs)->exp;
+static void PolyMakeUnique(Poly *p) {
+    assert(!PolyIsCoeff(p));
+    if (PolyIsInline(p)) {
+        Mono *arr = MonosAlloc(1);
+        arr[0] = (Mono) {.p = PolyFromCoeff(p->coeff), .exp = PolyInlineExp(p)};
+        *p = (Poly) {.size = 1, .arr = arr};
+    } else if (PolyHeader(p)->refcount == 1 && InternForget(p)) {
+        PlanDestroy(atomic_exchange(&PolyHeader(p)->plan, NULL));
+        PoolFree(atomic_exchange(&PolyHeader(p)->meta, NULL));
+    } else {
+        Mono *arr = MonosAlloc(p->size);
+        for (size_t i = 0; i < p->size; ++i) {
+            arr[i] = MonoClone(&p->arr[i]);
+        }
+        /* inny właściciel mógł w międzyczasie usunąć swoją kopię*/
+        Poly old = *p;
+        p->arr = arr;
+        PolyDestroy(&old);
+    }
 }
 
 /**
@@ -106,15 +422,20 @@ static bool PolyIsMonoZero(Poly *p) {
 }
 
 /**
- * Upraszcza wielomian.
+ * Upraszcza wielomian. Jednomian o współczynniku będącym liczbą
+ * jest zapisywany bez tablicy jednomianów.
  * @param[in] p : wielomian
  * @return wielomian uproszczony
  */
 static void PolyOptimize(Poly *p) {
     if (PolyIsMonoCoef(p) || PolyIsMonoZero(p)) {
         p->coeff = p->arr[0].p.coeff;
-        free(p->arr);
+        MonosFree(p->arr);
         p->arr = NULL;
+    } else if (PolyIsMono(p) && PolyIsCoeff(&p->arr[0].p)) {
+        Poly inline_mono = PolyFromInline(p->arr[0].p.coeff, MonoGetExp(&p->arr[0]));
+        MonosFree(p->arr);
+        *p = inline_mono;
     }
 }
 
@@ -129,13 +450,168 @@ static Mono MonoAdd(const Mono *lhs, const Mono *rhs) {
     return (Mono) {.p = PolyAdd(&lhs->p, &rhs->p), .exp = lhs->exp};
 }
 
-Poly PolyOwnMonos(size_t count, Mono *monos) {
-    if (count == 0 || monos == NULL) {
-        return PolyZero();
+/**
+ * Sortuje rosnąco według wykładników krótką tablicę jednomianów przez wstawianie.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów
+ */
+static void MonosInsertionSort(size_t count, Mono monos[]) {
+    for (size_t i = 1; i < count; ++i) {
+        Mono mono = monos[i];
+        size_t j = i;
+        while (j > 0 && MonoGetExp(&monos[j - 1]) > MonoGetExp(&mono)) {
+            monos[j] = monos[j - 1];
+            j--;
+        }
+        monos[j] = mono;
+    }
+}
+
+/**
+ * Scala parami sąsiednie posortowane serie jednomianów, aż zostanie jedna.
+ * Na każdym poziomie serie są przepisywane między tablicą @p monos
+ * a tablicą pomocniczą.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] runs : liczba serii
+ * @param[in,out] bounds : początki serii i @p count na końcu, @p runs + 1 pozycji
+ */
+static void MonosMergeRuns(size_t count, Mono monos[], size_t runs, size_t bounds[]) {
+    Mono *buffer = (Mono *) PoolAlloc(sizeof(struct Mono) * count);
+    Mono *from = monos;
+    Mono *to = buffer;
+    while (runs > 1) {
+        size_t merged = 0;
+        for (size_t r = 0; r < runs; r += 2) {
+            size_t i = bounds[r];
+            size_t middle = bounds[r + 1];
+            /* ostatnia seria bez pary jest tylko przepisywana*/
+            size_t end = (r + 1 < runs) ? bounds[r + 2] : middle;
+            size_t j = middle;
+            size_t k = i;
+            while (i < middle && j < end) {
+                to[k++] = (MonoGetExp(&from[j]) < MonoGetExp(&from[i])) ? from[j++] : from[i++];
+            }
+            while (i < middle) {
+                to[k++] = from[i++];
+            }
+            while (j < end) {
+                to[k++] = from[j++];
+            }
+            bounds[merged++] = bounds[r];
+        }
+        bounds[merged] = count;
+        runs = merged;
+        Mono *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != monos) {
+        memcpy(monos, from, sizeof(struct Mono) * count);
+    }
+    PoolFree(buffer);
+}
+
+/**
+ * Daje klucz sortowania pozycyjnego: wykładnik z odwróconym bitem znaku,
+ * więc porządek kluczy bez znaku jest porządkiem wykładników.
+ * @param[in] m : jednomian
+ * @return klucz jednomianu
+ */
+static unsigned MonoRadixKey(const Mono *m) {
+    return (unsigned) MonoGetExp(m) ^ (1u << (sizeof(poly_exp_t) * CHAR_BIT - 1));
+}
+
+/**
+ * Sortuje rosnąco według wykładników tablicę jednomianów sortowaniem
+ * pozycyjnym od najmłodszej cyfry. Liczności wszystkich cyfr są liczone
+ * w jednym przejściu, a cyfry wspólne dla wszystkich jednomianów są pomijane.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów
+ */
+static void MonosRadixSort(size_t count, Mono monos[]) {
+    size_t counts[RADIX_DIGITS][RADIX_SIZE] = {{0}};
+    for (size_t i = 0; i < count; ++i) {
+        unsigned key = MonoRadixKey(&monos[i]);
+        for (int d = 0; d < RADIX_DIGITS; ++d) {
+            counts[d][(key >> (d * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+    Mono *buffer = (Mono *) PoolAlloc(sizeof(struct Mono) * count);
+    Mono *from = monos;
+    Mono *to = buffer;
+    for (int d = 0; d < RADIX_DIGITS; ++d) {
+        int shift = d * RADIX_BITS;
+        /* wszystkie jednomiany mają tę samą cyfrę, przejście niczego nie zmieni*/
+        if (counts[d][(MonoRadixKey(&from[0]) >> shift) & (RADIX_SIZE - 1)] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t digit = 0; digit < RADIX_SIZE; ++digit) {
+            size_t digit_count = counts[d][digit];
+            counts[d][digit] = offset;
+            offset += digit_count;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            to[counts[d][(MonoRadixKey(&from[i]) >> shift) & (RADIX_SIZE - 1)]++] = from[i];
+        }
+        Mono *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != monos) {
+        memcpy(monos, from, sizeof(struct Mono) * count);
+    }
+    PoolFree(buffer);
+}
+
+/**
+ * Sortuje rosnąco według wykładników tablicę jednomianów. Posortowana
+ * tablica jest rozpoznawana jednym przejściem i nie jest przestawiana.
+ * Tablica złożona z kilku posortowanych serii jest scalana seriami,
+ * krótka sortowana przez wstawianie, a pozostałe sortowaniem pozycyjnym.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów
+ */
+static void MonosSort(size_t count, Mono monos[]) {
+    size_t bounds[SORT_MERGE_MAX_RUNS + 1];
+    size_t runs = 1;
+    bounds[0] = 0;
+    for (size_t i = 1; i < count; ++i) {
+        if (MonoGetExp(&monos[i]) < MonoGetExp(&monos[i - 1])) {
+            if (runs == SORT_MERGE_MAX_RUNS) {
+                runs++;
+                break;
+            }
+            bounds[runs++] = i;
+        }
+    }
+    if (runs == 1) {
+        return;
+    }
+    if (count <= SORT_INSERTION_MAX) {
+        MonosInsertionSort(count, monos);
+    } else if (runs <= SORT_MERGE_MAX_RUNS) {
+        bounds[runs] = count;
+        MonosMergeRuns(count, monos, runs, bounds);
+    } else {
+        MonosRadixSort(count, monos);
     }
+}
+
+/**
+ * Sumuje listę jednomianów i tworzy z nich wielomian. Przejmuje na własność
+ * pamięć wskazywaną przez @p monos i jej zawartość. Zakładamy, że pamięć
+ * wskazywana przez @p monos została przydzielona przez MonosAlloc.
+ * @param[in] count : liczba jednomianów, większa od zera
+ * @param[in] monos : tablica jednomianów
+ * @return wielomian będący sumą jednomianów
+ */
+static Poly PolyFromMonos(size_t count, Mono *monos) {
+    assert(count > 0 && monos != NULL);
     /* Od tego momentu wszystkie jednomiany w wielomianie będą sortowane według wykładnika.
      * Funkcje takie jak mnożenie, które psują porządek, będą musiały go przywrócić*/
-    qsort(monos, count, sizeof(struct Mono), MonoCompare);
+    MonosSort(count, monos);
 
     /* Od tego momentu dla każdego wykładnika istnieje dokładnie jeden jednomian w wielomianie z takim wykładnikiem*/
     size_t current = 0;
@@ -150,11 +626,8 @@ Poly PolyOwnMonos(size_t count, Mono *monos) {
                 monos[++current] = monos[next];
             }
         } else {
-            Mono sum = MonoAdd(&monos[current], &monos[next]);
-            MonoDestroy(&monos[current]);
-            MonoDestroy(&monos[next]);
             /* może pojawić się zero, pozbędziemy się go w następnej iteracji*/
-            monos[current] = sum;
+            monos[current].p = PolyAddOwn(&monos[current].p, &monos[next].p);
         }
     }
     /* Musimy pozbyć się ostatniego zera. Jeśli ostatnie zero jest jedynym elementem zostawiamy go*/
@@ -167,18 +640,26 @@ Poly PolyOwnMonos(size_t count, Mono *monos) {
     return result;
 }
 
+Poly PolyOwnMonos(size_t count, Mono *monos) {
+    if (count == 0 || monos == NULL) {
+        return PolyZero();
+    }
+    /* tablica pochodzi z malloc, a wielomiany trzymają jednomiany w tablicy z licznikiem referencji*/
+    Mono *monos_copy = MonosAlloc(count);
+    memcpy(monos_copy, monos, sizeof(struct Mono) * count);
+    free(monos);
+    return PolyFromMonos(count, monos_copy);
+}
+
 Poly PolyAddMonos(size_t count, const Mono monos[]) {
     if (count == 0 || monos == NULL) {
         return PolyZero();
     }
     /* Przejmujemy na własność zawartość tablicy monos(NIE TABLICĘ!).
      * Więc potrzebujemy kopii tablicy*/
-    Mono *monos_copy = (Mono *) malloc(sizeof(struct Mono) * count);
-    if (monos_copy == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
+    Mono *monos_copy = MonosAlloc(count);
     memcpy(monos_copy, monos, sizeof(struct Mono) * count);
-    return PolyOwnMonos(count, monos_copy);
+    return PolyFromMonos(count, monos_copy);
 }
 
 Poly PolyCloneMonos(size_t count, const Mono monos[]) {
@@ -187,14 +668,11 @@ Poly PolyCloneMonos(size_t count, const Mono monos[]) {
     }
     /* Przejmujemy na własność zawartość tablicy monos(NIE TABLICĘ!).
      * Więc potrzebujemy kopii tablicy*/
-    Mono *monos_copy = (Mono *) malloc(sizeof(struct Mono) * count);
-    if (monos_copy == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
+    Mono *monos_copy = MonosAlloc(count);
     for (size_t i = 0; i < count; ++i) {
         monos_copy[i] = MonoClone(&monos[i]);
     }
-    return PolyOwnMonos(count, monos_copy);
+    return PolyFromMonos(count, monos_copy);
 }
 
 /**
@@ -207,52 +685,160 @@ static poly_exp_t max(poly_exp_t lhs, poly_exp_t rhs) {
     return (lhs > rhs) ? lhs : rhs;
 }
 
+static const PolyMeta *PolyMetaOf(const Poly *p);
+
 /**
- * Zwraca stopień jednomianu.
- * @param[in] m : jednomian
- * @return stopień jednomianu @p m
+ * Miesza bity liczby 64-bitowej (funkcja kończąca generatora SplitMix64).
+ * @param[in] x : liczba
+ * @return wymieszana liczba
  */
-static poly_exp_t MonoDeg(const Mono *m) {
-    return (PolyDeg(&m->p) + MonoGetExp(m));
+static uint64_t HashMix(uint64_t x) {
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
 }
 
 /**
- * Zwraca stopień współczynnika jednomianu ze względu na zadaną zmienną.
- * @param[in] m : jednomian
- * @param[in] var_idx : indeks zmiennej
- * @return stopień współczynnika jednomianu @p m z względu na zmienną o indeksie @p var_idx
+ * Dołącza jednomian do skrótu wielomianu. Skrót wielomianu powstaje przez
+ * dołączanie kolejnych jednomianów do HASH_SEED.
+ * @param[in] hash : skrót poprzednich jednomianów
+ * @param[in] exp : wykładnik jednomianu
+ * @param[in] coeff_hash : skrót współczynnika jednomianu
+ * @return skrót z dołączonym jednomianem
+ */
+static uint64_t HashMono(uint64_t hash, poly_exp_t exp, uint64_t coeff_hash) {
+    return HashMix(hash ^ HashMix(coeff_hash + (uint64_t) exp * UINT64_C(0x9e3779b97f4a7c15)));
+}
+
+/**
+ * Daje liczbę zmiennych wielomianu, czyli głębokość jego drzewa.
+ * @param[in] p : wielomian
+ * @return liczba zmiennych
+ */
+static size_t PolyVars(const Poly *p) {
+    if (PolyIsCoeff(p)) {
+        return 0;
+    }
+    const PolyMeta *meta = PolyMetaOf(p);
+    return (meta != NULL) ? meta->vars : 1;
+}
+
+/**
+ * Daje liczbę niezerowych wyrazów wielomianu, czyli liści jego drzewa.
+ * @param[in] p : wielomian
+ * @return liczba wyrazów
+ */
+static size_t PolyTerms(const Poly *p) {
+    if (PolyIsCoeff(p)) {
+        return !PolyIsZero(p);
+    }
+    const PolyMeta *meta = PolyMetaOf(p);
+    return (meta != NULL) ? meta->terms : 1;
+}
+
+/**
+ * Daje łączny rozmiar tablic jednomianów w drzewie wielomianu.
+ * @param[in] p : wielomian
+ * @return rozmiar w bajtach
+ */
+static size_t PolyBytes(const Poly *p) {
+    const PolyMeta *meta = PolyMetaOf(p);
+    return (meta != NULL) ? meta->bytes : 0;
+}
+
+/**
+ * Daje zapamiętane dane o poddrzewie wielomianu, a jeśli jeszcze ich nie ma,
+ * liczy je z danych współczynników i zapisuje w nagłówku tablicy. Dane mogą
+ * być liczone jednocześnie w kilku wątkach; zapisywane są tylko jedne.
+ * Współczynniki, jednomiany zapisane bez tablicy i ich widoki nie mają danych.
+ * @param[in] p : wielomian
+ * @return dane o poddrzewie lub NULL
  */
-static poly_exp_t MonosCoefDegBy(const Mono *m, size_t var_idx) {
-    return PolyDegBy(&m->p, var_idx);
+static const PolyMeta *PolyMetaOf(const Poly *p) {
+    if (!PolyHasMonos(p) || PolyHeader(p)->refcount == 0) {
+        return NULL;
+    }
+    MonosHeader *header = PolyHeader(p);
+    PolyMeta *meta = atomic_load(&header->meta);
+    if (meta != NULL) {
+        return meta;
+    }
+    size_t vars = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        size_t coeff_vars = PolyVars(&p->arr[i].p);
+        vars = (coeff_vars > vars) ? coeff_vars : vars;
+    }
+    vars++;
+    meta = (PolyMeta *) PoolAlloc(sizeof(PolyMeta) + sizeof(poly_exp_t) * vars);
+    meta->deg = EXP_MIN;
+    meta->terms = 0;
+    meta->bytes = sizeof(MonosHeader) + sizeof(struct Mono) * p->size;
+    meta->vars = vars;
+    meta->hash = HASH_SEED;
+    atomic_init(&meta->interned, false);
+    /* tablica jednomianów jest posortowana, ostatni element ma największy wykładnik*/
+    meta->degs[0] = MonoGetExp(&p->arr[p->size - 1]);
+    for (size_t v = 1; v < vars; ++v) {
+        meta->degs[v] = 0;
+    }
+    for (size_t i = 0; i < p->size; ++i) {
+        const Poly *coeff = &p->arr[i].p;
+        meta->deg = max(PolyDeg(coeff) + MonoGetExp(&p->arr[i]), meta->deg);
+        meta->terms += PolyTerms(coeff);
+        meta->bytes += PolyBytes(coeff);
+        meta->hash = HashMono(meta->hash, MonoGetExp(&p->arr[i]), PolyHash(coeff));
+        for (size_t v = 1; v < vars; ++v) {
+            meta->degs[v] = max(PolyDegBy(coeff, v - 1), meta->degs[v]);
+        }
+    }
+    PolyMeta *expected = NULL;
+    if (!atomic_compare_exchange_strong(&header->meta, &expected, meta)) {
+        /* inny wątek zapisał już te same dane*/
+        PoolFree(meta);
+        meta = expected;
+    }
+    return meta;
 }
 
 poly_exp_t PolyDegBy(const Poly *p, size_t var_idx) {
     if (PolyIsCoeff(p)) {
         return PolyIsZero(p) ? -1 : 0;
     }
-    if (var_idx == 0) {
-        /* tablica jednomianów jest posortowana(tworzenie wielomianu z tablicy jednomianów),
-         * ostatni element ma największy wykładnik*/
-        return MonoGetExp(&p->arr[p->size - 1]);
-    } else {
-        poly_exp_t result = EXP_MIN;
-        for (size_t i = 0; i < p->size; ++i) {
-            result = max(MonosCoefDegBy(&p->arr[i], var_idx - 1), result);
+    const PolyMeta *meta = PolyMetaOf(p);
+    if (meta == NULL) {
+        /* jednomian o współczynniku liczbowym lub jego widok*/
+        poly_exp_t exp = PolyIsInline(p) ? PolyInlineExp(p) : MonoGetExp(&p->arr[0]);
+        return (var_idx == 0) ? exp : 0;
+    }
+    return (var_idx < meta->vars) ? meta->degs[var_idx] : 0;
+}
+
+uint64_t PolyHash(const Poly *p) {
+    if (PolyIsCoeff(p)) {
+        return HashMix((uint64_t) p->coeff);
+    }
+    const PolyMeta *meta = PolyMetaOf(p);
+    if (meta == NULL) {
+        /* jednomian o współczynniku liczbowym lub jego widok ma ten sam skrót co tablica z jednym jednomianem*/
+        if (PolyIsInline(p)) {
+            return HashMono(HASH_SEED, PolyInlineExp(p), HashMix((uint64_t) p->coeff));
         }
-        return result;
+        return HashMono(HASH_SEED, MonoGetExp(&p->arr[0]), PolyHash(&p->arr[0].p));
     }
+    return meta->hash;
 }
 
 poly_exp_t PolyDeg(const Poly *p) {
     if (PolyIsCoeff(p)) {
         return PolyIsZero(p) ? -1 : 0;
-    } else {
-        poly_exp_t result = EXP_MIN;
-        for (size_t i = 0; i < p->size; ++i) {
-            result = max(MonoDeg(&p->arr[i]), result);
-        }
-        return result;
     }
+    const PolyMeta *meta = PolyMetaOf(p);
+    if (meta == NULL) {
+        return PolyIsInline(p) ? PolyInlineExp(p) : MonoGetExp(&p->arr[0]);
+    }
+    return meta->deg;
 }
 
 /**
@@ -270,7 +856,23 @@ bool PolyIsEq(const Poly *p, const Poly *q) {
         /* p i q to oba współczynniki*/
         if (PolyIsCoeff(p)) {
             return p->coeff == q->coeff;
-        } else if (p->size != q->size) {
+        }
+        if (PolyIsInline(p) && PolyIsInline(q)) {
+            /* w polu arr zakodowane są wykładniki*/
+            return p->coeff == q->coeff && p->arr == q->arr;
+        }
+        PolyView p_view;
+        PolyView q_view;
+        p = PolyViewOf(p, &p_view);
+        q = PolyViewOf(q, &q_view);
+        if (p->arr == q->arr) {
+            /* wielomiany współdzielą tablicę jednomianów*/
+            return true;
+        } else if (PolyIsInterned(p) && PolyIsInterned(q)) {
+            /* równe wspólne węzły mają tę samą tablicę*/
+            return false;
+        } else if (p->size != q->size || PolyHash(p) != PolyHash(q)) {
+            /* różne skróty wykluczają równość, równe trzeba jeszcze sprawdzić*/
             return false;
         } else {
             for (size_t i = 0; i < p->size; ++i) {
@@ -285,40 +887,394 @@ bool PolyIsEq(const Poly *p, const Poly *q) {
     }
 }
 
-Poly PolySub(const Poly *p, const Poly *q) {
-    Poly temp = PolyNeg(q);
-    Poly result = PolyAdd(p, &temp);
-    PolyDestroy(&temp);
-    return result;
+/**
+ * Powiększa tablicę węzłów wspólnych dwukrotnie. Wymaga blokady intern_lock.
+ */
+static void InternGrow(void) {
+    size_t capacity = (intern_capacity == 0) ? INTERN_MIN_BUCKETS : 2 * intern_capacity;
+    InternEntry **buckets = (InternEntry **) PoolAlloc(sizeof(InternEntry *) * capacity);
+    memset(buckets, 0, sizeof(InternEntry *) * capacity);
+    for (size_t i = 0; i < intern_capacity; ++i) {
+        InternEntry *entry = intern_buckets[i];
+        while (entry != NULL) {
+            InternEntry *next = entry->next;
+            entry->next = buckets[entry->hash & (capacity - 1)];
+            buckets[entry->hash & (capacity - 1)] = entry;
+            entry = next;
+        }
+    }
+    PoolFree(intern_buckets);
+    intern_buckets = buckets;
+    intern_capacity = capacity;
 }
 
-Poly PolyNeg(const Poly *p) {
-    Poly neg = PolyFromCoeff(-1);
-    return PolyMul(p, &neg);
+/**
+ * Zastępuje węzły drzewa wielomianu węzłami wspólnymi, zaczynając od liści.
+ * Poddrzewa, które już są w tablicy węzłów wspólnych albo mają kilku
+ * właścicieli, zostają bez zmian: ich pamięć i tak jest współdzielona,
+ * a zastąpienie współczynników wymagałoby skopiowania tablicy. Jeśli
+ * w tablicy jest równy węzeł, wielomian staje się jego kopią, a w przeciwnym
+ * razie węzeł wielomianu trafia do tablicy.
+ * Przejmuje na własność zawartość struktury wskazywanej przez @p p.
+ * @param[in,out] p : wielomian
+ */
+static void PolyInternTree(Poly *p) {
+    if (!PolyHasMonos(p) || PolyIsInterned(p) || PolyHeader(p)->refcount > 1) {
+        return;
+    }
+    /* jedyny właściciel może zastąpić współczynniki w miejscu*/
+    for (size_t i = 0; i < p->size; ++i) {
+        PolyInternTree(&p->arr[i].p);
+    }
+    /* równe wspólne współczynniki są tymi samymi węzłami, więc ich porównania są płytkie*/
+    uint64_t hash = PolyHash(p);
+    pthread_mutex_lock(&intern_lock);
+    if (intern_count >= intern_capacity) {
+        InternGrow();
+    }
+    InternEntry **bucket = &intern_buckets[hash & (intern_capacity - 1)];
+    for (InternEntry *entry = *bucket; entry != NULL; entry = entry->next) {
+        if (entry->hash == hash && PolyIsEq(&entry->poly, p)) {
+            Poly shared = PolyClone(&entry->poly);
+            pthread_mutex_unlock(&intern_lock);
+            PolyDestroy(p);
+            *p = shared;
+            return;
+        }
+    }
+    InternEntry *entry = (InternEntry *) PoolAlloc(sizeof(InternEntry));
+    *entry = (InternEntry) {.poly = *p, .hash = hash, .next = *bucket};
+    *bucket = entry;
+    intern_count++;
+    atomic_store(&atomic_load(&PolyHeader(p)->meta)->interned, true);
+    pthread_mutex_unlock(&intern_lock);
+}
+
+Poly PolyIntern(Poly *p) {
+    if (atomic_load(&hash_consing)) {
+        PolyInternTree(p);
+    }
+    return *p;
+}
+
+void PolySetHashConsing(bool enabled) {
+    atomic_store(&hash_consing, enabled);
 }
 
 /**
- * Mnoży dwa wielomiany stałe (które są współczynnikiem).
- * @param[in] p : współczynnik @f$p@f$
- * @param[in] q : współczynnik @f$q@f$
- * @return @f$p * q@f$
+ * To jest typ wyliczeniowy operacji, których wyniki są zapamiętywane.
+ * Zapamiętywane są tylko wywołania PolyMul, PolyMulOwn i PolyCompose;
+ * iloczyny pośrednie liczone przez PolyMulHelper i PolyMulOwnHelper oraz
+ * potęgi liczone przez PowerCacheGet omijają pamięć podręczną wyników.
  */
-static Poly CoefMulCoef(poly_coeff_t p, poly_coeff_t q) {
-    return PolyFromCoeff(p * q);
+typedef enum ResultOp {
+    RESULT_MUL, ///< iloczyn dwóch wielomianów
+    RESULT_COMPOSE ///< złożenie wielomianu z tablicą wielomianów
+} ResultOp;
+
+/**
+ * To jest struktura przechowująca zapamiętany wynik operacji. Wpis trzyma
+ * kopie argumentów, aby przy trafieniu porównać je z nowymi argumentami,
+ * i należy jednocześnie do kubełka i do listy wpisów od ostatnio używanego.
+ */
+typedef struct ResultEntry {
+    ResultOp op; ///< operacja
+    uint64_t key; ///< skrót operacji i argumentów
+    size_t count; ///< liczba argumentów
+    Poly *args; ///< argumenty
+    Poly result; ///< wynik
+    size_t bytes; ///< pamięć zajmowana przez wpis
+    struct ResultEntry *next; ///< następny wpis w kubełku
+    struct ResultEntry *newer; ///< wpis używany później lub NULL
+    struct ResultEntry *older; ///< wpis używany wcześniej lub NULL
+} ResultEntry;
+
+/** Limit pamięci podręcznej wyników w bajtach, 0 ją wyłącza */
+static atomic_size_t result_budget = 0;
+/** Chroni pamięć podręczną wyników */
+static pthread_mutex_t result_lock = PTHREAD_MUTEX_INITIALIZER;
+/** Kubełki pamięci podręcznej wyników */
+static ResultEntry **result_buckets = NULL;
+/** Liczba kubełków, potęga dwójki */
+static size_t result_capacity = 0;
+/** Ostatnio używany wpis */
+static ResultEntry *result_newest = NULL;
+/** Najdawniej używany wpis */
+static ResultEntry *result_oldest = NULL;
+/** Liczniki pamięci podręcznej wyników */
+static PolyCacheStats result_stats = {0};
+
+/**
+ * Sprawdza, czy wyniki operacji mają być zapamiętywane.
+ * @return Czy pamięć podręczna wyników jest włączona?
+ */
+static bool ResultCacheEnabled(void) {
+    return atomic_load(&result_budget) > 0;
 }
 
 /**
- * Mnoży dwa wielomiany: nie stały i stały (który jest współczynnikiem).
- * @param[in] p : wielomian nie stały @f$p@f$
- * @param[in] q : współczynnik @f$q@f$
- * @return @f$p * q@f$
+ * Liczy skrót operacji i jej argumentów.
+ * @param[in] op : operacja
+ * @param[in] count : liczba argumentów
+ * @param[in] args : argumenty
+ * @return skrót
  */
-static Poly PolyMulCoef(const Poly *p, poly_coeff_t q) {
-    if (q == 0) {
-        return PolyZero();
+static uint64_t ResultKey(ResultOp op, size_t count, const Poly args[]) {
+    uint64_t key = HashMix(HASH_SEED + op);
+    for (size_t i = 0; i < count; ++i) {
+        key = HashMix(key ^ PolyHash(&args[i]));
     }
-    assert(p->size > 0);
-    Poly result = PolyInit(p->size);
+    return key;
+}
+
+/**
+ * Przesuwa wpis na początek listy wpisów od ostatnio używanego.
+ * Wymaga blokady result_lock.
+ * @param[in,out] entry : wpis
+ * @param[in] linked : Czy wpis jest już na liście?
+ */
+static void ResultTouch(ResultEntry *entry, bool linked) {
+    if (linked) {
+        if (entry == result_newest) {
+            return;
+        }
+        entry->newer->older = entry->older;
+        if (entry->older != NULL) {
+            entry->older->newer = entry->newer;
+        } else {
+            result_oldest = entry->newer;
+        }
+    }
+    entry->newer = NULL;
+    entry->older = result_newest;
+    if (result_newest != NULL) {
+        result_newest->newer = entry;
+    } else {
+        result_oldest = entry;
+    }
+    result_newest = entry;
+}
+
+/**
+ * Wyjmuje najdawniej używane wpisy, dopóki pamięć podręczna przekracza
+ * limit. Wymaga blokady result_lock.
+ * @return lista wyjętych wpisów połączona polem next
+ */
+static ResultEntry *ResultEvict(void) {
+    ResultEntry *evicted = NULL;
+    while (result_oldest != NULL && result_stats.bytes > atomic_load(&result_budget)) {
+        ResultEntry *entry = result_oldest;
+        result_oldest = entry->newer;
+        if (result_oldest != NULL) {
+            result_oldest->older = NULL;
+        } else {
+            result_newest = NULL;
+        }
+        ResultEntry **bucket = &result_buckets[entry->key & (result_capacity - 1)];
+        while (*bucket != entry) {
+            bucket = &(*bucket)->next;
+        }
+        *bucket = entry->next;
+        result_stats.entries--;
+        result_stats.bytes -= entry->bytes;
+        entry->next = evicted;
+        evicted = entry;
+    }
+    return evicted;
+}
+
+/**
+ * Usuwa wyjęte wpisy. Nie wymaga blokady, bo wpisy nie są już dostępne.
+ * @param[in] evicted : lista wpisów połączona polem next
+ */
+static void ResultDestroyAll(ResultEntry *evicted) {
+    while (evicted != NULL) {
+        ResultEntry *next = evicted->next;
+        for (size_t i = 0; i < evicted->count; ++i) {
+            PolyDestroy(&evicted->args[i]);
+        }
+        PoolFree(evicted->args);
+        PolyDestroy(&evicted->result);
+        PoolFree(evicted);
+        evicted = next;
+    }
+}
+
+/**
+ * Powiększa tablicę kubełków pamięci podręcznej wyników dwukrotnie.
+ * Wymaga blokady result_lock.
+ */
+static void ResultGrow(void) {
+    size_t capacity = (result_capacity == 0) ? RESULT_MIN_BUCKETS : 2 * result_capacity;
+    ResultEntry **buckets = (ResultEntry **) PoolAlloc(sizeof(ResultEntry *) * capacity);
+    memset(buckets, 0, sizeof(ResultEntry *) * capacity);
+    for (size_t i = 0; i < result_capacity; ++i) {
+        ResultEntry *entry = result_buckets[i];
+        while (entry != NULL) {
+            ResultEntry *next = entry->next;
+            entry->next = buckets[entry->key & (capacity - 1)];
+            buckets[entry->key & (capacity - 1)] = entry;
+            entry = next;
+        }
+    }
+    PoolFree(result_buckets);
+    result_buckets = buckets;
+    result_capacity = capacity;
+}
+
+/**
+ * Szuka wpisu operacji o równych argumentach. Wymaga blokady result_lock.
+ * @param[in] op : operacja
+ * @param[in] key : skrót operacji i argumentów
+ * @param[in] count : liczba argumentów
+ * @param[in] args : argumenty
+ * @return wpis lub NULL
+ */
+static ResultEntry *ResultLookup(ResultOp op, uint64_t key, size_t count, const Poly args[]) {
+    if (result_capacity == 0) {
+        return NULL;
+    }
+    for (ResultEntry *entry = result_buckets[key & (result_capacity - 1)]; entry != NULL; entry = entry->next) {
+        if (entry->op != op || entry->key != key || entry->count != count) {
+            continue;
+        }
+        bool equal = true;
+        for (size_t i = 0; i < count && equal; ++i) {
+            equal = PolyIsEq(&entry->args[i], &args[i]);
+        }
+        if (equal) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Daje zapamiętany wynik operacji o równych argumentach.
+ * @param[in] op : operacja
+ * @param[in] key : skrót operacji i argumentów (zob. ResultKey)
+ * @param[in] count : liczba argumentów
+ * @param[in] args : argumenty
+ * @param[out] result : kopia zapamiętanego wyniku
+ * @return Czy wynik był zapamiętany?
+ */
+static bool ResultFind(ResultOp op, uint64_t key, size_t count, const Poly args[], Poly *result) {
+    pthread_mutex_lock(&result_lock);
+    ResultEntry *entry = ResultLookup(op, key, count, args);
+    if (entry != NULL) {
+        ResultTouch(entry, true);
+        *result = PolyClone(&entry->result);
+        result_stats.hits++;
+    } else {
+        result_stats.misses++;
+    }
+    pthread_mutex_unlock(&result_lock);
+    return entry != NULL;
+}
+
+/**
+ * Zapamiętuje wynik operacji razem z kopiami argumentów, usuwając
+ * najdawniej używane wyniki ponad limit. Wynik większy niż cały limit
+ * nie jest zapamiętywany.
+ * @param[in] op : operacja
+ * @param[in] key : skrót operacji i argumentów (zob. ResultKey)
+ * @param[in] count : liczba argumentów
+ * @param[in] args : argumenty
+ * @param[in] result : wynik
+ */
+static void ResultStore(ResultOp op, uint64_t key, size_t count, const Poly args[], const Poly *result) {
+    size_t bytes = sizeof(ResultEntry) + sizeof(Poly) * count + PolyBytes(result);
+    for (size_t i = 0; i < count; ++i) {
+        bytes += PolyBytes(&args[i]);
+    }
+    if (bytes > atomic_load(&result_budget)) {
+        return;
+    }
+    pthread_mutex_lock(&result_lock);
+    /* ten sam wynik mógł w międzyczasie zapamiętać inny wątek*/
+    if (ResultLookup(op, key, count, args) != NULL) {
+        pthread_mutex_unlock(&result_lock);
+        return;
+    }
+    if (result_stats.entries >= result_capacity) {
+        ResultGrow();
+    }
+    ResultEntry *entry = (ResultEntry *) PoolAlloc(sizeof(ResultEntry));
+    *entry = (ResultEntry) {.op = op, .key = key, .count = count, .result = PolyClone(result), .bytes = bytes};
+    entry->args = (Poly *) PoolAlloc(sizeof(Poly) * count);
+    for (size_t i = 0; i < count; ++i) {
+        entry->args[i] = PolyClone(&args[i]);
+    }
+    ResultEntry **bucket = &result_buckets[key & (result_capacity - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    ResultTouch(entry, false);
+    result_stats.entries++;
+    result_stats.bytes += bytes;
+    ResultEntry *evicted = ResultEvict();
+    pthread_mutex_unlock(&result_lock);
+    ResultDestroyAll(evicted);
+}
+
+void PolySetResultCache(size_t bytes) {
+    pthread_mutex_lock(&result_lock);
+    atomic_store(&result_budget, bytes);
+    ResultEntry *evicted = ResultEvict();
+    if (result_stats.entries == 0) {
+        PoolFree(result_buckets);
+        result_buckets = NULL;
+        result_capacity = 0;
+    }
+    pthread_mutex_unlock(&result_lock);
+    ResultDestroyAll(evicted);
+}
+
+PolyCacheStats PolyResultCacheStats(void) {
+    pthread_mutex_lock(&result_lock);
+    PolyCacheStats stats = result_stats;
+    pthread_mutex_unlock(&result_lock);
+    return stats;
+}
+
+Poly PolySub(const Poly *p, const Poly *q) {
+    Poly temp = PolyNeg(q);
+    Poly result = PolyAdd(p, &temp);
+    PolyDestroy(&temp);
+    return result;
+}
+
+Poly PolyNeg(const Poly *p) {
+    Poly neg = PolyFromCoeff(-1);
+    return PolyMul(p, &neg);
+}
+
+/**
+ * Mnoży dwa wielomiany stałe (które są współczynnikiem).
+ * @param[in] p : współczynnik @f$p@f$
+ * @param[in] q : współczynnik @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly CoefMulCoef(poly_coeff_t p, poly_coeff_t q) {
+    return PolyFromCoeff(p * q);
+}
+
+/**
+ * Mnoży dwa wielomiany: nie stały i stały (który jest współczynnikiem).
+ * @param[in] p : wielomian nie stały @f$p@f$
+ * @param[in] q : współczynnik @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulCoef(const Poly *p, poly_coeff_t q) {
+    if (q == 0) {
+        return PolyZero();
+    }
+    if (PolyIsInline(p)) {
+        /* zero może powstać przez przepełnienie*/
+        poly_coeff_t coeff = p->coeff * q;
+        return (coeff == 0) ? PolyZero() : PolyFromInline(coeff, PolyInlineExp(p));
+    }
+    assert(p->size > 0);
+    Poly result = PolyInit(p->size);
     result.size = 0;
     for (size_t i = 0; i < p->size; ++i) {
         Poly mul;
@@ -340,7 +1296,7 @@ static Poly PolyMulCoef(const Poly *p, poly_coeff_t q) {
     /* były tylko zera, nic nie zostało zapisane do wyniku*/
     if (result.size == 0) {
         /* nie używamy funkcji destroy, ponieważ wynik jest niezainicjalizowaną wartością*/
-        free(result.arr);
+        MonosFree(result.arr);
         return PolyZero();
     }
     PolyOptimize(&result);
@@ -348,40 +1304,718 @@ static Poly PolyMulCoef(const Poly *p, poly_coeff_t q) {
 }
 
 /**
- * Mnoży dwa wielomiany nie stałe.
+ * Element kopca używanego przy scalaniu list jednomianów. Przy mnożeniu
+ * wielomianów reprezentuje iloczyn jednomianu @f$i@f$-tego z krótszego
+ * czynnika i @f$j@f$-tego z dłuższego, a przy sumowaniu wielomianów
+ * @f$j@f$-ty jednomian @f$i@f$-tego składnika.
+ */
+typedef struct HeapEntry {
+    poly_exp_t exp; ///< wykładnik jednomianu
+    size_t i; ///< indeks pierwszego poziomu
+    size_t j; ///< indeks drugiego poziomu
+} HeapEntry;
+
+/**
+ * Porównuje elementy kopca według wykładnika.
+ * @param[in] lhs : element kopca
+ * @param[in] rhs : element kopca
+ * @return Czy @p lhs ma mniejszy wykładnik niż @p rhs?
+ */
+static bool HeapEntryLess(const void *lhs, const void *rhs) {
+    return ((const HeapEntry *) lhs)->exp < ((const HeapEntry *) rhs)->exp;
+}
+
+/**
+ * Wstawia element do kopca minimalnego (według wykładnika).
+ * @param[in,out] heap : kopiec
+ * @param[in,out] size : liczba elementów w kopcu
+ * @param[in] entry : nowy element
+ */
+static void HeapPush(HeapEntry *heap, size_t *size, HeapEntry entry) {
+    HeapInsert(heap, size, sizeof(HeapEntry), &entry, HeapEntryLess);
+}
+
+/**
+ * Usuwa z kopca minimalnego element o najmniejszym wykładniku.
+ * @param[in,out] heap : niepusty kopiec
+ * @param[in,out] size : liczba elementów w kopcu
+ * @return usunięty element
+ */
+static HeapEntry HeapPop(HeapEntry *heap, size_t *size) {
+    HeapEntry top;
+    HeapRemove(heap, size, sizeof(HeapEntry), &top, HeapEntryLess);
+    return top;
+}
+
+/**
+ * Dopisuje jednomian na koniec tablicy jednomianów, w razie potrzeby
+ * powiększając tablicę. Przejmuje na własność zawartość struktury
+ * wskazywanej przez @p mono.
+ * @param[in,out] result : wielomian w budowie
+ * @param[in,out] capacity : pojemność tablicy jednomianów
+ * @param[in] mono : jednomian
+ */
+static void PolyAppendMono(Poly *result, size_t *capacity, Mono *mono) {
+    if (result->size == *capacity) {
+        *capacity *= 2;
+        result->arr = MonosRealloc(result->arr, *capacity);
+    }
+    result->arr[result->size++] = *mono;
+}
+
+/**
+ * Daje rozpiętość wykładników wielomianu: liczbę wykładników od najmniejszego
+ * do największego włącznie.
+ * @param[in] p : wielomian z tablicą jednomianów
+ * @return rozpiętość wykładników
+ */
+static size_t PolyExpSpan(const Poly *p) {
+    return (size_t) (MonoGetExp(&p->arr[p->size - 1]) - MonoGetExp(&p->arr[0])) + 1;
+}
+
+/** Najmniejsza liczba par jednomianów, od której mnożenie dzielimy między wątki */
+#define PARALLEL_MIN_PAIRS 4096
+/** Liczba jednomianów każdego czynnika, z których próbkujemy wykładniki wyniku */
+#define PARALLEL_SAMPLES 32
+
+/** Największa liczba zmiennych, dla której pakujemy wykładniki podstawieniem Kroneckera */
+#define KRONECKER_MAX_VARS 16
+/** Najmniejsza liczba par wyrazów czynników, od której opłaca się podstawienie Kroneckera */
+#define KRONECKER_MIN_PAIRS 16
+/** Największa długość gęstej tablicy wyniku podstawienia Kroneckera */
+#define KRONECKER_MAX_SPAN ((size_t) 1 << 22)
+/** Ile razy motylek transformaty kosztuje więcej niż para wyrazów mnożona w gęstej tablicy */
+#define NTT_PAIR_COST 4
+
+/**
+ * Liczy wagi zmiennych w podstawieniu Kroneckera
+ * @f$x_i = y^{w_i}@f$. Waga ostatniej zmiennej to 1, a każda poprzednia
+ * jest iloczynem ograniczeń @f$\deg_{x_j} p + \deg_{x_j} q + 1@f$ dla
+ * dalszych zmiennych, więc wykładniki iloczynu dają się jednoznacznie
+ * rozpakować, a kolejność wyrazów w drzewie zgadza się z kolejnością
+ * upakowanych wykładników.
  * @param[in] p : wielomian nie stały @f$p@f$
  * @param[in] q : wielomian nie stały @f$q@f$
- * @return @f$p * q@f$
+ * @param[in] nvars : liczba zmiennych
+ * @param[out] weights : wagi zmiennych, @p nvars + 1 pozycji
+ * @return Czy upakowane wykładniki iloczynu mieszczą się w 62 bitach?
  */
-static Poly PolyMulPoly(const Poly *p, const Poly *q) {
-    size_t init_size = p->size * q->size;
-    Mono *init_arr = (Mono *) malloc(sizeof(struct Mono) * init_size);
-    if (init_arr == NULL) {
-        exit(ERROR_EXIT_STATUS);
+static bool KroneckerWeights(const Poly *p, const Poly *q, size_t nvars, uint64_t weights[]) {
+    weights[nvars] = 1;
+    for (size_t v = nvars; v-- > 0;) {
+        uint64_t bound = (uint64_t) PolyDegBy(p, v) + (uint64_t) PolyDegBy(q, v) + 1;
+        if (weights[v + 1] > (UINT64_C(1) << 62) / bound) {
+            return false;
+        }
+        weights[v] = weights[v + 1] * bound;
     }
-    size_t current = 0;
+    return true;
+}
+
+/**
+ * Pakuje wyrazy wielomianu do ciągu upakowanych wykładników i współczynników.
+ * Wyrazy są wypisywane w kolejności rosnących upakowanych wykładników.
+ * @param[in] p : wielomian zmiennych @f$x_{var\_idx}, x_{var\_idx + 1}, \ldots@f$
+ * @param[in] var_idx : indeks pierwszej zmiennej
+ * @param[in] base : upakowany wykładnik wspólny dla wyrazów @p p
+ * @param[in] weights : wagi zmiennych
+ * @param[out] exps : upakowane wykładniki
+ * @param[out] coeffs : współczynniki
+ * @param[in,out] count : liczba wypisanych wyrazów
+ */
+static void PolyPack(const Poly *p, size_t var_idx, uint64_t base, const uint64_t weights[],
+                     uint64_t exps[], poly_coeff_t coeffs[], size_t *count) {
+    if (PolyIsCoeff(p)) {
+        if (p->coeff != 0) {
+            exps[*count] = base;
+            coeffs[(*count)++] = p->coeff;
+        }
+        return;
+    }
+    PolyView view;
+    p = PolyViewOf(p, &view);
     for (size_t i = 0; i < p->size; ++i) {
-        for (size_t j = 0; j < q->size; ++j) {
-            Poly mul = PolyMul(&p->arr[i].p, &q->arr[j].p);
-            /* pomijamy zero*/
-            if (!PolyIsZero(&mul)) {
-                init_arr[current] = MonoFromPoly(&mul, MonoGetExp(&p->arr[i]) + MonoGetExp(&q->arr[j]));
-                current++;
+        PolyPack(&p->arr[i].p, var_idx + 1, base + (uint64_t) MonoGetExp(&p->arr[i]) * weights[var_idx + 1],
+                 weights, exps, coeffs, count);
+    }
+}
+
+/**
+ * Odtwarza wielomian z posortowanych upakowanych wyrazów o wspólnych
+ * wykładnikach zmiennych przed @f$x_{var\_idx}@f$.
+ * @param[in] count : liczba wyrazów, co najmniej 1
+ * @param[in] exps : upakowane wykładniki
+ * @param[in] coeffs : niezerowe współczynniki
+ * @param[in] var_idx : indeks zmiennej
+ * @param[in] nvars : liczba zmiennych
+ * @param[in] weights : wagi zmiennych
+ * @return wielomian
+ */
+static Poly PolyUnpack(size_t count, const uint64_t exps[], const poly_coeff_t coeffs[],
+                       size_t var_idx, size_t nvars, const uint64_t weights[]) {
+    if (var_idx == nvars) {
+        assert(count == 1);
+        return PolyFromCoeff(coeffs[0]);
+    }
+    uint64_t bound = weights[var_idx] / weights[var_idx + 1];
+    size_t groups = 1;
+    for (size_t i = 1; i < count; ++i) {
+        groups += (exps[i] / weights[var_idx + 1] != exps[i - 1] / weights[var_idx + 1]);
+    }
+    Poly result = PolyInit(groups);
+    size_t begin = 0;
+    for (size_t g = 0; g < groups; ++g) {
+        size_t end = begin + 1;
+        while (end < count && exps[end] / weights[var_idx + 1] == exps[begin] / weights[var_idx + 1]) {
+            end++;
+        }
+        Poly child = PolyUnpack(end - begin, exps + begin, coeffs + begin, var_idx + 1, nvars, weights);
+        poly_exp_t exp = (poly_exp_t) (exps[begin] / weights[var_idx + 1] % bound);
+        result.arr[g] = MonoFromPoly(&child, exp);
+        begin = end;
+    }
+    PolyOptimize(&result);
+    return result;
+}
+
+/**
+ * Daje koszt splotu przez NTT w motylkach transformat.
+ * @param[in] count : długość splotu
+ * @return koszt splotu
+ */
+static size_t NttCost(size_t count) {
+    size_t length = NttLength(count);
+    size_t log_length = 1;
+    while (((size_t) 1 << log_length) < length) {
+        log_length++;
+    }
+    /* trzy liczby pierwsze, po trzy transformaty, każda ma length / 2 * log_length motylków*/
+    return 9 * (length / 2) * log_length;
+}
+
+/**
+ * To jest struktura opisująca splot w gęstej tablicy podzielony na
+ * rozłączne przedziały pozycji wyniku.
+ */
+typedef struct DenseChunks {
+    size_t p_terms; ///< liczba wyrazów pierwszego czynnika
+    size_t q_terms; ///< liczba wyrazów drugiego czynnika
+    const uint64_t *exps; ///< upakowane wykładniki obu czynników, kolejno
+    const poly_coeff_t *coeffs; ///< współczynniki obu czynników, kolejno
+    size_t span; ///< długość wyniku
+    size_t count; ///< liczba przedziałów
+    poly_coeff_t *product; ///< wynik
+} DenseChunks;
+
+/**
+ * Liczy jeden przedział pozycji splotu w gęstej tablicy. Dla każdego
+ * wyrazu pierwszego czynnika wyszukuje binarnie wyrazy drugiego, których
+ * iloczyny trafiają do przedziału, więc przedziały można liczyć niezależnie.
+ * @param[in,out] arg : splot podzielony na przedziały
+ * @param[in] index : numer przedziału
+ */
+static void DenseChunk(void *arg, size_t index) {
+    DenseChunks *chunks = arg;
+    const uint64_t *p_exps = chunks->exps;
+    const uint64_t *q_exps = chunks->exps + chunks->p_terms;
+    const poly_coeff_t *p_coeffs = chunks->coeffs;
+    const poly_coeff_t *q_coeffs = chunks->coeffs + chunks->p_terms;
+    uint64_t low = chunks->span * index / chunks->count;
+    uint64_t high = chunks->span * (index + 1) / chunks->count;
+    memset(chunks->product + low, 0, sizeof(poly_coeff_t) * (high - low));
+    for (size_t i = 0; i < chunks->p_terms; ++i) {
+        uint64_t row = p_exps[i] - p_exps[0];
+        if (row >= high) {
+            break;
+        }
+        /* pierwszy wyraz q, którego iloczyn z i-tym wyrazem p trafia do przedziału*/
+        size_t begin = 0;
+        size_t end = chunks->q_terms;
+        while (begin < end) {
+            size_t middle = begin + (end - begin) / 2;
+            if (row + (q_exps[middle] - q_exps[0]) < low) {
+                begin = middle + 1;
+            } else {
+                end = middle;
             }
         }
+        for (size_t j = begin; j < chunks->q_terms && row + (q_exps[j] - q_exps[0]) < high; ++j) {
+            chunks->product[row + (q_exps[j] - q_exps[0])] += p_coeffs[i] * q_coeffs[j];
+        }
     }
-    Poly result;
-    if (current == 0) {
-        result = PolyZero();
+}
+
+/**
+ * Mnoży wielomiany podstawieniem Kroneckera: oba czynniki są pakowane do
+ * wielomianów jednej zmiennej, mnożonych jednym splotem w gęstej tablicy
+ * (przez NTT, jeśli jest dość długi), a iloczyn jest rozpakowywany z powrotem
+ * do postaci rekurencyjnej. Zastępuje to rekurencyjne mnożenie współczynników
+ * i drobne przydziały pamięci jednym przebiegiem po ciągłych tablicach.
+ * @param[in] p : wielomian z tablicą jednomianów @f$p@f$
+ * @param[in] q : wielomian z tablicą jednomianów @f$q@f$
+ * @param[out] result : @f$p * q@f$, jeśli podstawienie się opłaca
+ * @return Czy iloczyn został policzony?
+ */
+static bool PolyMulKronecker(const Poly *p, const Poly *q, Poly *result) {
+    size_t p_terms = PolyTerms(p);
+    size_t q_terms = PolyTerms(q);
+    size_t p_depth = PolyVars(p);
+    size_t q_depth = PolyVars(q);
+    size_t nvars = (p_depth > q_depth) ? p_depth : q_depth;
+    size_t pairs = p_terms * q_terms;
+    uint64_t weights[KRONECKER_MAX_VARS + 1];
+    if (pairs < KRONECKER_MIN_PAIRS || nvars > KRONECKER_MAX_VARS
+        || !KroneckerWeights(p, q, nvars, weights)) {
+        return false;
+    }
+    /* wyrazy obu czynników leżą w jednej tablicy, później trafiają do niej wyrazy wyniku*/
+    uint64_t *exps = PoolAlloc((sizeof(uint64_t) + sizeof(poly_coeff_t)) * (p_terms + q_terms));
+    poly_coeff_t *coeffs = (poly_coeff_t *) (exps + p_terms + q_terms);
+    size_t count = 0;
+    PolyPack(p, 0, 0, weights, exps, coeffs, &count);
+    PolyPack(q, 0, 0, weights, exps, coeffs, &count);
+    uint64_t p_low = exps[0];
+    uint64_t q_low = exps[p_terms];
+    size_t p_span = (size_t) (exps[p_terms - 1] - p_low) + 1;
+    size_t q_span = (size_t) (exps[p_terms + q_terms - 1] - q_low) + 1;
+    size_t span = p_span + q_span - 1;
+    bool use_ntt = pairs / NTT_PAIR_COST >= NttCost(span);
+    if (!use_ntt && (span > pairs || span > KRONECKER_MAX_SPAN)) {
+        PoolFree(exps);
+        return false;
+    }
+
+    poly_coeff_t *product = PoolAlloc(sizeof(poly_coeff_t) * (span + (use_ntt ? p_span + q_span : 0)));
+    if (use_ntt) {
+        poly_coeff_t *p_dense = product + span;
+        poly_coeff_t *q_dense = p_dense + p_span;
+        memset(p_dense, 0, sizeof(poly_coeff_t) * (p_span + q_span));
+        for (size_t i = 0; i < p_terms; ++i) {
+            p_dense[exps[i] - p_low] = coeffs[i];
+        }
+        for (size_t j = p_terms; j < p_terms + q_terms; ++j) {
+            q_dense[exps[j] - q_low] = coeffs[j];
+        }
+        /* kwadrat: ta sama tablica pozwala liczyć jedną transformatę mniej*/
+        NttConvolve(p_span, p_dense, q_span, (p == q) ? p_dense : q_dense, product);
     } else {
-        /* używamy tej funkcji, aby przywrócić zepsuty porządek i unikalność każdego wykładnika*/
-        result = PolyAddMonos(current, init_arr);
+        DenseChunks chunks = {.p_terms = p_terms, .q_terms = q_terms, .exps = exps, .coeffs = coeffs,
+                              .span = span, .count = 1, .product = product};
+        if (pairs >= PARALLEL_MIN_PAIRS) {
+            chunks.count = SchedulerThreads() * TASKS_PER_THREAD;
+        }
+        SchedulerParallelFor(chunks.count, DenseChunk, &chunks);
+    }
+
+    count = 0;
+    for (size_t k = 0; k < span && count < p_terms + q_terms; ++k) {
+        count += (product[k] != 0);
+    }
+    if (count == p_terms + q_terms) {
+        /* wynik ma więcej wyrazów niż czynniki razem, potrzebne są większe tablice*/
+        PoolFree(exps);
+        count = 0;
+        for (size_t k = 0; k < span; ++k) {
+            count += (product[k] != 0);
+        }
+        exps = PoolAlloc((sizeof(uint64_t) + sizeof(poly_coeff_t)) * count);
+        coeffs = (poly_coeff_t *) (exps + count);
+    }
+    count = 0;
+    for (size_t k = 0; k < span; ++k) {
+        if (product[k] != 0) {
+            exps[count] = p_low + q_low + k;
+            coeffs[count++] = product[k];
+        }
+    }
+    PoolFree(product);
+    *result = (count == 0) ? PolyZero() : PolyUnpack(count, exps, coeffs, 0, nvars, weights);
+    PoolFree(exps);
+    return true;
+}
+
+static Poly PolyMulHelper(const Poly *p, const Poly *q);
+
+/** Najmniejsza liczba jednomianów każdego z czynników, od której rozważamy algorytm Karatsuby */
+#define KARATSUBA_MIN_SIZE 32
+/** Długość ciągów, poniżej której algorytm Karatsuby mnoży je szkolnie */
+#define KARATSUBA_CUTOFF 8
+
+/**
+ * Sprawdza, czy iloczyn wielomianów opłaca się policzyć algorytmem Karatsuby.
+ * Oba czynniki muszą być dość długie i gęste: co najmniej połowa wykładników
+ * z ich rozpiętości ma niezerowe współczynniki.
+ * @param[in] p : wielomian z tablicą jednomianów @f$p@f$
+ * @param[in] q : wielomian z tablicą jednomianów @f$q@f$
+ * @return Czy liczyć iloczyn algorytmem Karatsuby?
+ */
+static bool PolyMulUseKaratsuba(const Poly *p, const Poly *q) {
+    return p->size >= KARATSUBA_MIN_SIZE && q->size >= KARATSUBA_MIN_SIZE
+           && PolyExpSpan(p) <= 2 * p->size && PolyExpSpan(q) <= 2 * q->size;
+}
+
+/**
+ * Dodaje do ciągu @p out splot ciągów współczynników @p a i @p b tej samej
+ * długości algorytmem Karatsuby: @f$(a_0 + x^h a_1)(b_0 + x^h b_1)@f$ wymaga
+ * tylko trzech iloczynów połówek, bo
+ * @f$a_0 b_1 + a_1 b_0 = (a_0 + a_1)(b_0 + b_1) - a_0 b_0 - a_1 b_1@f$.
+ * Współczynniki są dowolnymi wielomianami pozostałych zmiennych.
+ * @param[in] n : długość ciągów @p a i @p b
+ * @param[in] a : ciąg @f$a@f$
+ * @param[in] b : ciąg @f$b@f$
+ * @param[in,out] out : ciąg o @f$2n - 1@f$ wyrazach, do którego dodajemy splot
+ */
+static void KaratsubaMul(size_t n, const Poly a[], const Poly b[], Poly out[]) {
+    if (n <= KARATSUBA_CUTOFF) {
+        for (size_t i = 0; i < n; ++i) {
+            if (PolyIsZero(&a[i])) {
+                continue;
+            }
+            for (size_t j = 0; j < n; ++j) {
+                if (!PolyIsZero(&b[j])) {
+                    Poly mul = PolyMulHelper(&a[i], &b[j]);
+                    out[i + j] = PolyAddOwn(&out[i + j], &mul);
+                }
+            }
+        }
+        return;
+    }
+    /* dolne połówki mają h wyrazów, górne high >= h*/
+    size_t h = n / 2;
+    size_t high = n - h;
+    Poly *buffer = PoolAlloc(sizeof(Poly) * (2 * high + (2 * h - 1) + 2 * (2 * high - 1)));
+    Poly *a_sum = buffer;
+    Poly *b_sum = a_sum + high;
+    Poly *z0 = b_sum + high;
+    Poly *z1 = z0 + 2 * h - 1;
+    Poly *z2 = z1 + 2 * high - 1;
+    for (size_t i = 0; i < high; ++i) {
+        a_sum[i] = (i < h) ? PolyAdd(&a[i], &a[h + i]) : PolyClone(&a[h + i]);
+        b_sum[i] = (i < h) ? PolyAdd(&b[i], &b[h + i]) : PolyClone(&b[h + i]);
+    }
+    for (size_t k = 0; k < (2 * h - 1) + 2 * (2 * high - 1); ++k) {
+        z0[k] = PolyZero();
+    }
+    KaratsubaMul(h, a, b, z0);
+    KaratsubaMul(high, a_sum, b_sum, z1);
+    KaratsubaMul(high, a + h, b + h, z2);
+    for (size_t i = 0; i < high; ++i) {
+        PolyDestroy(&a_sum[i]);
+        PolyDestroy(&b_sum[i]);
+    }
+
+    /* z1 - z0 - z2 to środkowy wyraz, kopie są tanie dzięki współdzieleniu tablic*/
+    for (size_t k = 0; k < 2 * high - 1; ++k) {
+        Poly z2_copy = PolyClone(&z2[k]);
+        z1[k] = PolySubOwn(&z1[k], &z2_copy);
+        if (k < 2 * h - 1) {
+            Poly z0_copy = PolyClone(&z0[k]);
+            z1[k] = PolySubOwn(&z1[k], &z0_copy);
+        }
+    }
+    for (size_t k = 0; k < 2 * h - 1; ++k) {
+        out[k] = PolyAddOwn(&out[k], &z0[k]);
+    }
+    for (size_t k = 0; k < 2 * high - 1; ++k) {
+        out[h + k] = PolyAddOwn(&out[h + k], &z1[k]);
+        out[2 * h + k] = PolyAddOwn(&out[2 * h + k], &z2[k]);
+    }
+    PoolFree(buffer);
+}
+
+/**
+ * Rozpisuje jednomiany wielomianu w gęsty ciąg współczynników przesunięty
+ * o najmniejszy wykładnik. Współczynniki nie są kopiowane, ciąg je tylko wskazuje.
+ * @param[in] p : wielomian z tablicą jednomianów
+ * @param[out] dense : ciąg o co najmniej PolyExpSpan(p) wyrazach
+ * @param[in] length : długość ciągu, pozostałe wyrazy są zerami
+ */
+static void PolyToDense(const Poly *p, Poly dense[], size_t length) {
+    for (size_t k = 0; k < length; ++k) {
+        dense[k] = PolyZero();
+    }
+    poly_exp_t low = MonoGetExp(&p->arr[0]);
+    for (size_t i = 0; i < p->size; ++i) {
+        dense[MonoGetExp(&p->arr[i]) - low] = p->arr[i].p;
+    }
+}
+
+/**
+ * Mnoży dwa gęste wielomiany algorytmem Karatsuby. Krótszy czynnik jest
+ * mnożony przez kolejne kawałki dłuższego tej samej długości, więc
+ * czynniki o różnych długościach nie są dopełniane zerami do dłuższego.
+ * @param[in] p : wielomian z tablicą jednomianów @f$p@f$
+ * @param[in] q : wielomian z tablicą jednomianów @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulKaratsuba(const Poly *p, const Poly *q) {
+    const Poly *shorter = (PolyExpSpan(p) <= PolyExpSpan(q)) ? p : q;
+    const Poly *longer = (shorter == p) ? q : p;
+    size_t n = PolyExpSpan(shorter);
+    size_t chunks = (PolyExpSpan(longer) + n - 1) / n;
+    /* ostatni kawałek jest dopełniony zerami, więc wynik ma zapas n wyrazów*/
+    size_t count = chunks * n + n - 1;
+    Poly *dense = PoolAlloc(sizeof(Poly) * (n + chunks * n + count));
+    Poly *short_dense = dense;
+    Poly *long_dense = dense + n;
+    Poly *product = long_dense + chunks * n;
+    PolyToDense(shorter, short_dense, n);
+    PolyToDense(longer, long_dense, chunks * n);
+    for (size_t k = 0; k < count; ++k) {
+        product[k] = PolyZero();
     }
-    free(init_arr);
+    for (size_t c = 0; c < chunks; ++c) {
+        KaratsubaMul(n, long_dense + c * n, short_dense, product + c * n);
+    }
+
+    poly_exp_t low = MonoGetExp(&p->arr[0]) + MonoGetExp(&q->arr[0]);
+    size_t size = 0;
+    for (size_t k = 0; k < count; ++k) {
+        size += !PolyIsZero(&product[k]);
+    }
+    if (size == 0) {
+        PoolFree(dense);
+        return PolyZero();
+    }
+    Poly result = PolyInit(size);
+    size = 0;
+    for (size_t k = 0; k < count; ++k) {
+        if (!PolyIsZero(&product[k])) {
+            result.arr[size++] = MonoFromPoly(&product[k], low + (poly_exp_t) k);
+        }
+    }
+    PoolFree(dense);
+    PolyOptimize(&result);
     return result;
 }
 
-Poly PolyMul(const Poly *p, const Poly *q) {
+/**
+ * Daje indeks pierwszego jednomianu o wykładniku co najmniej @p exp.
+ * @param[in] p : wielomian z tablicą jednomianów
+ * @param[in] exp : wykładnik
+ * @return indeks jednomianu lub @p p->size, jeśli takiego nie ma
+ */
+static size_t MonosLowerBound(const Poly *p, long long exp) {
+    size_t low = 0;
+    size_t high = p->size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (MonoGetExp(&p->arr[middle]) < exp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * Mnoży wielomiany, scalając iloczyny jednomianów kopcem, ale tylko te,
+ * których wykładnik leży w przedziale od @p low do @p high włącznie.
+ * Kopiec zawiera po jednym iloczynie z każdym jednomianem krótszego czynnika.
+ * @param[in] shorter : krótszy czynnik z tablicą jednomianów
+ * @param[in] longer : dłuższy czynnik z tablicą jednomianów
+ * @param[in] low : najmniejszy wykładnik
+ * @param[in] high : największy wykładnik
+ * @return wielomian z jednomianami iloczynu z przedziału, być może bez żadnego
+ */
+static Poly PolyMulHeap(const Poly *shorter, const Poly *longer, poly_exp_t low, poly_exp_t high) {
+    HeapEntry *heap = (HeapEntry *) PoolAlloc(sizeof(HeapEntry) * shorter->size);
+    size_t heap_size = 0;
+    for (size_t i = 0; i < shorter->size; ++i) {
+        poly_exp_t exp = MonoGetExp(&shorter->arr[i]);
+        size_t j = MonosLowerBound(longer, (long long) low - exp);
+        if (j < longer->size && exp + MonoGetExp(&longer->arr[j]) <= high) {
+            HeapPush(heap, &heap_size, (HeapEntry) {.exp = exp + MonoGetExp(&longer->arr[j]), .i = i, .j = j});
+        }
+    }
+
+    size_t capacity = longer->size;
+    Poly result = PolyInit(capacity);
+    result.size = 0;
+    /* suma iloczynów o wykładniku sum_exp */
+    Poly sum = PolyZero();
+    poly_exp_t sum_exp = (heap_size > 0) ? heap[0].exp : low;
+    while (heap_size > 0) {
+        HeapEntry top = HeapPop(heap, &heap_size);
+        /* następny iloczyn z tym samym jednomianem krótszego czynnika */
+        if (top.j + 1 < longer->size) {
+            poly_exp_t exp = MonoGetExp(&shorter->arr[top.i]) + MonoGetExp(&longer->arr[top.j + 1]);
+            if (exp <= high) {
+                HeapPush(heap, &heap_size, (HeapEntry) {.exp = exp, .i = top.i, .j = top.j + 1});
+            }
+        }
+
+        if (top.exp != sum_exp) {
+            /* wszystkie iloczyny o wykładniku sum_exp zostały zsumowane, pomijamy zero */
+            if (!PolyIsZero(&sum)) {
+                Mono mono = MonoFromPoly(&sum, sum_exp);
+                PolyAppendMono(&result, &capacity, &mono);
+            }
+            sum = PolyZero();
+            sum_exp = top.exp;
+        }
+        Poly mul = PolyMulHelper(&shorter->arr[top.i].p, &longer->arr[top.j].p);
+        sum = PolyAddOwn(&sum, &mul);
+    }
+    if (!PolyIsZero(&sum)) {
+        Mono mono = MonoFromPoly(&sum, sum_exp);
+        PolyAppendMono(&result, &capacity, &mono);
+    }
+    PoolFree(heap);
+    return result;
+}
+
+/**
+ * To jest struktura opisująca mnożenie podzielone na przedziały wykładników wyniku.
+ */
+typedef struct MulChunks {
+    const Poly *shorter; ///< krótszy czynnik
+    const Poly *longer; ///< dłuższy czynnik
+    long long *bounds; ///< najmniejsze wykładniki przedziałów, o jeden więcej niż przedziałów
+    Poly *parts; ///< jednomiany iloczynu z kolejnych przedziałów
+} MulChunks;
+
+/**
+ * Mnoży wielomiany w jednym przedziale wykładników wyniku.
+ * @param[in,out] arg : mnożenie podzielone na przedziały
+ * @param[in] index : numer przedziału
+ */
+static void MulChunk(void *arg, size_t index) {
+    MulChunks *chunks = arg;
+    chunks->parts[index] = PolyMulHeap(chunks->shorter, chunks->longer,
+                                       (poly_exp_t) chunks->bounds[index],
+                                       (poly_exp_t) (chunks->bounds[index + 1] - 1));
+}
+
+/**
+ * Porównuje dwa wykładniki.
+ * @param[in] lhs : wskaźnik na wykładnik
+ * @param[in] rhs : wskaźnik na wykładnik
+ * @return wynik porównania jak w MonoCompare
+ */
+static int ExpCompare(const void *lhs, const void *rhs) {
+    long long a = *(const long long *) lhs;
+    long long b = *(const long long *) rhs;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Mnoży wielomiany kopcem na kilku wątkach. Zakres wykładników wyniku jest
+ * dzielony na przedziały o zbliżonej liczbie iloczynów jednomianów według
+ * próbki wykładników iloczynów. Każdy przedział jest liczony osobno,
+ * a wyniki są sklejane w kolejności przedziałów, więc iloczyn jest taki sam
+ * jak przy mnożeniu na jednym wątku.
+ * @param[in] shorter : krótszy czynnik z tablicą jednomianów
+ * @param[in] longer : dłuższy czynnik z tablicą jednomianów
+ * @return iloczyn czynników
+ */
+static Poly PolyMulParallel(const Poly *shorter, const Poly *longer) {
+    size_t rows = (shorter->size < PARALLEL_SAMPLES) ? shorter->size : PARALLEL_SAMPLES;
+    size_t columns = (longer->size < PARALLEL_SAMPLES) ? longer->size : PARALLEL_SAMPLES;
+    size_t samples = rows * columns;
+    size_t count = SchedulerThreads() * TASKS_PER_THREAD;
+    long long *sums = PoolAlloc(sizeof(long long) * (samples + count + 1));
+    long long *bounds = sums + samples;
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < columns; ++c) {
+            sums[r * columns + c] = (long long) MonoGetExp(&shorter->arr[r * shorter->size / rows])
+                                    + MonoGetExp(&longer->arr[c * longer->size / columns]);
+        }
+    }
+    qsort(sums, samples, sizeof(long long), ExpCompare);
+    /* granice przedziałów to kwantyle próbki, pomijamy powtórzenia*/
+    bounds[0] = (long long) MonoGetExp(&shorter->arr[0]) + MonoGetExp(&longer->arr[0]);
+    size_t chunks_count = 1;
+    for (size_t c = 1; c < count; ++c) {
+        long long bound = sums[c * samples / count];
+        if (bound > bounds[chunks_count - 1]) {
+            bounds[chunks_count++] = bound;
+        }
+    }
+    bounds[chunks_count] = (long long) MonoGetExp(&shorter->arr[shorter->size - 1])
+                           + MonoGetExp(&longer->arr[longer->size - 1]) + 1;
+
+    Poly *parts = PoolAlloc(sizeof(Poly) * chunks_count);
+    MulChunks chunks = {.shorter = shorter, .longer = longer, .bounds = bounds, .parts = parts};
+    SchedulerParallelFor(chunks_count, MulChunk, &chunks);
+    size_t size = 0;
+    for (size_t c = 0; c < chunks_count; ++c) {
+        size += parts[c].size;
+    }
+    Poly result = (size == 0) ? PolyZero() : PolyInit(size);
+    size = 0;
+    for (size_t c = 0; c < chunks_count; ++c) {
+        if (parts[c].size > 0) {
+            memcpy(result.arr + size, parts[c].arr, sizeof(Mono) * parts[c].size);
+            size += parts[c].size;
+        }
+        /* jednomiany przeszły do wyniku, zwalniamy tylko tablicę*/
+        MonosFree(parts[c].arr);
+    }
+    PoolFree(parts);
+    PoolFree(sums);
+    if (size > 0) {
+        PolyOptimize(&result);
+    }
+    return result;
+}
+
+/**
+ * Mnoży dwa wielomiany nie stałe.
+ * Iloczyny jednomianów są generowane w kolejności rosnących wykładników
+ * przez scalanie kopcem (algorytm Johnsona): dla każdego jednomianu krótszego
+ * czynnika kopiec trzyma najmniejszy jeszcze nie wygenerowany iloczyn
+ * z jednomianem dłuższego czynnika. Iloczyny o tym samym wykładniku są od razu
+ * sumowane, więc wynik nie wymaga sortowania, a dodatkowa pamięć jest
+ * proporcjonalna do długości krótszego czynnika. Jeśli to możliwe, iloczyn
+ * jest liczony podstawieniem Kroneckera, a w przeciwnym razie długie gęste
+ * wielomiany są mnożone algorytmem Karatsuby. Duże iloczyny liczone kopcem
+ * są dzielone między wątki (zob. PolyMulParallel).
+ * @param[in] p : wielomian nie stały @f$p@f$
+ * @param[in] q : wielomian nie stały @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulPoly(const Poly *p, const Poly *q) {
+    if (PolyIsInline(p) && PolyIsInline(q)) {
+        poly_coeff_t coeff = p->coeff * q->coeff;
+        return (coeff == 0) ? PolyZero() : PolyFromInline(coeff, PolyInlineExp(p) + PolyInlineExp(q));
+    }
+    PolyView p_view;
+    PolyView q_view;
+    p = PolyViewOf(p, &p_view);
+    q = PolyViewOf(q, &q_view);
+    Poly product;
+    if (PolyMulKronecker(p, q, &product)) {
+        return product;
+    }
+    if (PolyMulUseKaratsuba(p, q)) {
+        return PolyMulKaratsuba(p, q);
+    }
+    const Poly *shorter = (p->size <= q->size) ? p : q;
+    const Poly *longer = (p->size <= q->size) ? q : p;
+    if (SchedulerThreads() > 1 && shorter->size * longer->size >= PARALLEL_MIN_PAIRS) {
+        return PolyMulParallel(shorter, longer);
+    }
+    Poly result = PolyMulHeap(shorter, longer, MonoGetExp(&shorter->arr[0]) + MonoGetExp(&longer->arr[0]),
+                              MonoGetExp(&shorter->arr[shorter->size - 1]) + MonoGetExp(&longer->arr[longer->size - 1]));
+    /* były tylko zera, nic nie zostało zapisane do wyniku*/
+    if (result.size == 0) {
+        /* nie używamy funkcji destroy, ponieważ wynik jest niezainicjalizowaną wartością*/
+        MonosFree(result.arr);
+        return PolyZero();
+    }
+    PolyOptimize(&result);
+    return result;
+}
+
+/**
+ * Mnoży dwa wielomiany bez pamięci podręcznej wyników.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulHelper(const Poly *p, const Poly *q) {
     if (PolyIsCoeff(p) == PolyIsCoeff(q)) {
         if (PolyIsCoeff(p)) {
             return CoefMulCoef(p->coeff, q->coeff);
@@ -397,6 +2031,52 @@ Poly PolyMul(const Poly *p, const Poly *q) {
     }
 }
 
+/** Czy duże iloczyny są liczone w postaci rozproszonej? */
+static atomic_bool dist_mul = false;
+
+/**
+ * Mnoży dwa wielomiany bez pamięci podręcznej wyników. Jeśli włączone jest
+ * mnożenie w postaci rozproszonej (zob. PolySetDistMul), a czynniki mają
+ * razem dość wyrazów i dają się w niej zapisać, liczy iloczyn przez nią.
+ * Postać rozproszona obejmuje od razu wszystkie zmienne, więc próba jest
+ * podejmowana tylko dla całych czynników, a nie dla ich współczynników.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulTop(const Poly *p, const Poly *q) {
+    Poly result;
+    if (atomic_load(&dist_mul) && PolyHasMonos(p) && PolyHasMonos(q)
+        && PolyTerms(p) * PolyTerms(q) >= DIST_MUL_MIN_PAIRS && DistMulTry(p, q, &result)) {
+        return result;
+    }
+    return PolyMulHelper(p, q);
+}
+
+void PolySetDistMul(bool enabled) {
+    atomic_store(&dist_mul, enabled);
+}
+
+Poly PolyMul(const Poly *p, const Poly *q) {
+    /* mnożenie przez jednomian lub współczynnik jest tańsze niż liczenie skrótów*/
+    if (!ResultCacheEnabled() || !PolyHasMonos(p) || !PolyHasMonos(q)) {
+        return PolyMulTop(p, q);
+    }
+    /* mnożenie jest przemienne, więc czynniki porządkujemy według skrótów*/
+    Poly args[2] = {*p, *q};
+    if (PolyHash(p) > PolyHash(q)) {
+        args[0] = *q;
+        args[1] = *p;
+    }
+    uint64_t key = ResultKey(RESULT_MUL, 2, args);
+    Poly result;
+    if (!ResultFind(RESULT_MUL, key, 2, args, &result)) {
+        result = PolyMulTop(p, q);
+        ResultStore(RESULT_MUL, key, 2, args, &result);
+    }
+    return result;
+}
+
 /**
  * Dodaje dwa wielomiany stałe (które są współczynnikiem).
  * @param[in] p : współczynnik @f$p@f$
@@ -417,6 +2097,8 @@ static Poly PolyAddCoef(const Poly *p, poly_coeff_t q) {
     if (q == 0) {
         return PolyClone(p);
     }
+    PolyView view;
+    p = PolyViewOf(p, &view);
     assert(p->size > 0);
     Poly result;
     /* wykładniki są posortowane i unikalne -> współczynnik może pojawić się tylko na pierwszej pozycji*/
@@ -448,9 +2130,46 @@ static Poly PolyAddCoef(const Poly *p, poly_coeff_t q) {
             result.arr[i + 1] = MonoClone(&p->arr[i]);
         }
     }
+    /* po skróceniu wyrazu wolnego może zostać jeden jednomian*/
+    PolyOptimize(&result);
     return result;
 }
 
+/**
+ * To jest struktura opisująca parę jednomianów o tym samym wykładniku
+ * w dodawanych wielomianach.
+ */
+typedef struct AddPair {
+    size_t i; ///< indeks jednomianu pierwszego składnika
+    size_t j; ///< indeks jednomianu drugiego składnika
+    size_t slot; ///< miejsce sumy w wyniku
+} AddPair;
+
+/**
+ * To jest struktura opisująca sumy par jednomianów podzielone na zadania.
+ */
+typedef struct AddTasks {
+    const Poly *p; ///< pierwszy składnik
+    const Poly *q; ///< drugi składnik
+    Mono *result; ///< tablica jednomianów wyniku
+    AddPair *pairs; ///< pary jednomianów o tym samym wykładniku
+    size_t size; ///< liczba par
+    size_t count; ///< liczba zadań
+} AddTasks;
+
+/**
+ * Dodaje pary jednomianów z jednego przedziału.
+ * @param[in,out] arg : sumy par podzielone na zadania
+ * @param[in] index : numer zadania
+ */
+static void AddTask(void *arg, size_t index) {
+    AddTasks *tasks = arg;
+    for (size_t k = tasks->size * index / tasks->count; k < tasks->size * (index + 1) / tasks->count; ++k) {
+        AddPair *pair = &tasks->pairs[k];
+        tasks->result[pair->slot] = MonoAdd(&tasks->p->arr[pair->i], &tasks->q->arr[pair->j]);
+    }
+}
+
 /**
  * Dodaje dwa wielomiany nie stałe.
  * @param[in] p : wielomian nie stały @f$p@f$
@@ -458,7 +2177,23 @@ static Poly PolyAddCoef(const Poly *p, poly_coeff_t q) {
  * @return @f$p + q@f$
  */
 static Poly PolyAddPoly(const Poly *p, const Poly *q) {
+    if (PolyIsInline(p) && PolyIsInline(q) && p->arr == q->arr) {
+        /* jednomiany o tym samym wykładniku*/
+        poly_coeff_t coeff = p->coeff + q->coeff;
+        return (coeff == 0) ? PolyZero() : PolyFromInline(coeff, PolyInlineExp(p));
+    }
+    PolyView p_view;
+    PolyView q_view;
+    p = PolyViewOf(p, &p_view);
+    q = PolyViewOf(q, &q_view);
     Poly result = PolyInit(p->size + q->size);
+    /* dla dużych składników sumy jednomianów o tym samym wykładniku są odkładane
+     * na później i liczone w zadaniach, dla małych liczymy je od razu*/
+    AddTasks tasks = {.p = p, .q = q, .result = result.arr, .pairs = NULL, .count = 0, .size = 0};
+    size_t monos = 0;
+    if (PolyUseTasks(p) || PolyUseTasks(q)) {
+        tasks.pairs = (AddPair *) PoolAlloc(sizeof(AddPair) * ((p->size < q->size) ? p->size : q->size));
+    }
     size_t i = 0;
     size_t j = 0;
     size_t current = 0;
@@ -473,6 +2208,13 @@ static Poly PolyAddPoly(const Poly *p, const Poly *q) {
             result.arr[current] = MonoClone(&q->arr[j]);
             j++;
             current++;
+        } else if (tasks.pairs != NULL) {
+            tasks.pairs[tasks.size++] = (AddPair) {.i = i, .j = j, .slot = current};
+            monos += (PolyHasMonos(&p->arr[i].p) ? p->arr[i].p.size : 1)
+                     + (PolyHasMonos(&q->arr[j].p) ? q->arr[j].p.size : 1);
+            i++;
+            j++;
+            current++;
         } else {
             Mono sum = MonoAdd(&p->arr[i], &q->arr[j]);
             if (!MonoIsZero(&sum)) {
@@ -499,10 +2241,23 @@ static Poly PolyAddPoly(const Poly *p, const Poly *q) {
         j++;
         current++;
     }
+    if (tasks.pairs != NULL) {
+        tasks.count = (monos + tasks.size >= TASK_MIN_MONOS) ? TaskCount(tasks.size) : 1;
+        SchedulerParallelFor(tasks.count, AddTask, &tasks);
+        /* usuwamy sumy równe zeru, zachowując kolejność*/
+        size_t kept = 0;
+        for (size_t k = 0; k < current; ++k) {
+            if (!MonoIsZero(&result.arr[k])) {
+                result.arr[kept++] = result.arr[k];
+            }
+        }
+        current = kept;
+        PoolFree(tasks.pairs);
+    }
     /* były tylko zera, nic nie zostało zapisane do wyniku*/
     if (current == 0) {
         /* nie używamy funkcji destroy, ponieważ wynik jest niezainicjalizowaną wartością*/
-        free(result.arr);
+        MonosFree(result.arr);
         return PolyZero();
     }
     result.size = current;
@@ -513,22 +2268,235 @@ static Poly PolyAddPoly(const Poly *p, const Poly *q) {
 Poly PolyAdd(const Poly *p, const Poly *q) {
     if (PolyIsCoeff(p) == PolyIsCoeff(q)) {
         if (PolyIsCoeff(p)) {
-            return CoefAddCoef(p->coeff, q->coeff);
+            return CoefAddCoef(p->coeff, q->coeff);
+        } else {
+            return PolyAddPoly(p, q);
+        }
+    } else {
+        if (PolyIsCoeff(p)) {
+            return PolyAddCoef(q, p->coeff);
+        } else {
+            return PolyAddCoef(p, q->coeff);
+        }
+    }
+}
+
+/**
+ * Dodaje do wielomianu nie stałego współczynnik. Przejmuje na własność
+ * zawartość struktury wskazywanej przez @p p i używa ponownie jej tablicy
+ * jednomianów.
+ * @param[in] p : wielomian nie stały @f$p@f$
+ * @param[in] q : współczynnik @f$q@f$
+ * @return @f$p + q@f$
+ */
+static Poly PolyAddCoefOwn(Poly *p, poly_coeff_t q) {
+    if (q == 0) {
+        return *p;
+    }
+    PolyMakeUnique(p);
+    assert(p->size > 0);
+    Poly coef = PolyFromCoeff(q);
+    /* wykładniki są posortowane i unikalne -> współczynnik może pojawić się tylko na pierwszej pozycji*/
+    if (MonoGetExp(&p->arr[0]) == 0) {
+        p->arr[0].p = PolyAddOwn(&p->arr[0].p, &coef);
+        if (MonoIsZero(&p->arr[0])) {
+            /* pomijamy zero*/
+            memmove(p->arr, p->arr + 1, sizeof(struct Mono) * (p->size - 1));
+            p->size--;
+        }
+    } else {
+        p->arr = MonosRealloc(p->arr, p->size + 1);
+        memmove(p->arr + 1, p->arr, sizeof(struct Mono) * p->size);
+        p->arr[0] = MonoFromPoly(&coef, 0);
+        p->size++;
+    }
+    Poly result = *p;
+    if (result.size == 0) {
+        MonosFree(result.arr);
+        return PolyZero();
+    }
+    PolyOptimize(&result);
+    return result;
+}
+
+/**
+ * Dodaje dwa wielomiany nie stałe. Przejmuje na własność zawartość struktur
+ * wskazywanych przez @p p i @p q. Jednomiany są scalane od końca w tablicy
+ * dłuższego wielomianu, więc współczynniki nie są kopiowane.
+ * @param[in] p : wielomian nie stały @f$p@f$
+ * @param[in] q : wielomian nie stały @f$q@f$
+ * @return @f$p + q@f$
+ */
+static Poly PolyAddPolyOwn(Poly *p, Poly *q) {
+    if (PolyIsInline(p) && PolyIsInline(q)) {
+        return PolyAddPoly(p, q);
+    }
+    PolyMakeUnique(p);
+    PolyMakeUnique(q);
+    if (p->size < q->size) {
+        Poly *temp = p;
+        p = q;
+        q = temp;
+    }
+    size_t total = p->size + q->size;
+    Mono *arr = MonosRealloc(p->arr, total);
+    /* i, j, current to liczby jednomianów jeszcze nie przetworzonych */
+    size_t i = p->size;
+    size_t j = q->size;
+    size_t current = total;
+    while (i > 0 && j > 0) {
+        poly_exp_t p_exp = MonoGetExp(&arr[i - 1]);
+        poly_exp_t q_exp = MonoGetExp(&q->arr[j - 1]);
+        if (p_exp > q_exp) {
+            arr[--current] = arr[--i];
+        } else if (p_exp < q_exp) {
+            arr[--current] = q->arr[--j];
+        } else {
+            i--;
+            j--;
+            Mono sum = {.p = PolyAddOwn(&arr[i].p, &q->arr[j].p), .exp = p_exp};
+            /* pomijamy zero*/
+            if (!MonoIsZero(&sum)) {
+                arr[--current] = sum;
+            }
+        }
+    }
+    while (i > 0) {
+        arr[--current] = arr[--i];
+    }
+    while (j > 0) {
+        arr[--current] = q->arr[--j];
+    }
+    /* jednomiany z q przeszły do wyniku, zwalniamy tylko tablicę*/
+    MonosFree(q->arr);
+
+    size_t size = total - current;
+    if (size == 0) {
+        MonosFree(arr);
+        return PolyZero();
+    }
+    memmove(arr, arr + current, sizeof(struct Mono) * size);
+    Poly result = (Poly) {.size = size, .arr = arr};
+    PolyOptimize(&result);
+    return result;
+}
+
+Poly PolyAddOwn(Poly *p, Poly *q) {
+    if (PolyIsCoeff(p) == PolyIsCoeff(q)) {
+        if (PolyIsCoeff(p)) {
+            return CoefAddCoef(p->coeff, q->coeff);
+        } else {
+            return PolyAddPolyOwn(p, q);
+        }
+    } else {
+        if (PolyIsCoeff(p)) {
+            return PolyAddCoefOwn(q, p->coeff);
+        } else {
+            return PolyAddCoefOwn(p, q->coeff);
+        }
+    }
+}
+
+Poly PolyNegOwn(Poly *p) {
+    if (PolyIsCoeff(p)) {
+        return PolyFromCoeff(-p->coeff);
+    }
+    if (PolyIsInline(p)) {
+        return PolyFromInline(-p->coeff, PolyInlineExp(p));
+    }
+    PolyMakeUnique(p);
+    /* przeciwny do niezerowego współczynnika nie jest zerem, więc nie trzeba upraszczać*/
+    for (size_t i = 0; i < p->size; ++i) {
+        p->arr[i].p = PolyNegOwn(&p->arr[i].p);
+    }
+    return *p;
+}
+
+Poly PolySubOwn(Poly *p, Poly *q) {
+    Poly neg = PolyNegOwn(q);
+    return PolyAddOwn(p, &neg);
+}
+
+/**
+ * Mnoży wielomian nie stały przez współczynnik. Przejmuje na własność
+ * zawartość struktury wskazywanej przez @p p i używa ponownie jej tablicy
+ * jednomianów.
+ * @param[in] p : wielomian nie stały @f$p@f$
+ * @param[in] q : współczynnik @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulCoefOwn(Poly *p, poly_coeff_t q) {
+    if (q == 0) {
+        PolyDestroy(p);
+        return PolyZero();
+    }
+    if (PolyIsInline(p)) {
+        return PolyMulCoef(p, q);
+    }
+    assert(p->size > 0);
+    PolyMakeUnique(p);
+    size_t current = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        Mono mono = p->arr[i];
+        if (PolyIsCoeff(&mono.p)) {
+            mono.p = CoefMulCoef(mono.p.coeff, q);
+        } else {
+            mono.p = PolyMulCoefOwn(&mono.p, q);
+        }
+        /* pomijamy zero (może powstać przez przepełnienie)*/
+        if (!MonoIsZero(&mono)) {
+            p->arr[current++] = mono;
+        }
+    }
+    Poly result = (Poly) {.size = current, .arr = p->arr};
+    if (current == 0) {
+        MonosFree(result.arr);
+        return PolyZero();
+    }
+    PolyOptimize(&result);
+    return result;
+}
+
+/**
+ * Mnoży dwa wielomiany bez pamięci podręcznej wyników.
+ * Przejmuje na własność zawartość struktur wskazywanych przez @p p i @p q.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p * q@f$
+ */
+static Poly PolyMulOwnHelper(Poly *p, Poly *q) {
+    if (PolyIsCoeff(p) == PolyIsCoeff(q)) {
+        if (PolyIsCoeff(p)) {
+            return CoefMulCoef(p->coeff, q->coeff);
         } else {
-            return PolyAddPoly(p, q);
+            Poly result = PolyMulPoly(p, q);
+            PolyDestroy(p);
+            PolyDestroy(q);
+            return result;
         }
     } else {
         if (PolyIsCoeff(p)) {
-            return PolyAddCoef(q, p->coeff);
+            return PolyMulCoefOwn(q, p->coeff);
         } else {
-            return PolyAddCoef(p, q->coeff);
+            return PolyMulCoefOwn(p, q->coeff);
         }
     }
 }
 
+Poly PolyMulOwn(Poly *p, Poly *q) {
+    if ((!ResultCacheEnabled() && !atomic_load(&dist_mul)) || !PolyHasMonos(p) || !PolyHasMonos(q)) {
+        return PolyMulOwnHelper(p, q);
+    }
+    /* iloczyn wielomianów nie stałych i tak nie używa tablic argumentów*/
+    Poly result = PolyMul(p, q);
+    PolyDestroy(p);
+    PolyDestroy(q);
+    return result;
+}
+
 /**
  * Wylicza @f$exp@f$-tą potęgę współczynnika @f$base@f$.
- * Źródło: https://www.geeksforgeeks.org/modular-exponentiation-PolyPow-in-modular-arithmetic/
+ * Źródło: https://www.geeksforgeeks.org/modular-exponentiation-power-in-modular-arithmetic/
  * @param[in] base : współczynnik @f$base@f$
  * @param[in] exp : wykładnik @f$exp@f$
  * @return @f$base^{exp}@f$
@@ -547,39 +2515,460 @@ static poly_coeff_t Power(poly_coeff_t base, poly_exp_t exp) {
     return result;
 }
 
+/**
+ * Wylicza kombinację liniową wielomianów @f$\sum_i weights_i \cdot polys_i@f$
+ * w jednym przebiegu, bez wyników pośrednich. Listy jednomianów składników
+ * są scalane kopcem według wykładników; współczynniki jednomianów o tym samym
+ * wykładniku tworzą kombinację liniową o poziom niżej, liczoną rekurencyjnie.
+ * Jeśli wszystkie składniki są współczynnikami, wynik jest liczony bez
+ * przydzielania pamięci.
+ * @param[in] count : liczba składników
+ * @param[in] polys : składniki
+ * @param[in] weights : wagi składników
+ * @return @f$\sum_i weights_i \cdot polys_i@f$
+ */
+static Poly PolyLinComb(size_t count, const Poly *const polys[], const poly_coeff_t weights[]) {
+    /* współczynniki składników sumują się do jednego współczynnika (wykładnik 0)*/
+    poly_coeff_t scalar = 0;
+    size_t sources = 0;
+    size_t last_source = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (weights[i] == 0) {
+            continue;
+        }
+        if (PolyIsCoeff(polys[i])) {
+            scalar += weights[i] * polys[i]->coeff;
+        } else {
+            sources++;
+            last_source = i;
+        }
+    }
+    if (sources == 0) {
+        return PolyFromCoeff(scalar);
+    }
+    if (sources == 1 && scalar == 0) {
+        /* jedyny składnik nie trzeba z niczym scalać*/
+        if (weights[last_source] == 1) {
+            return PolyClone(polys[last_source]);
+        }
+        return PolyMulCoef(polys[last_source], weights[last_source]);
+    }
+
+    /* jednomiany zapisane bez tablicy przechodzimy przez ich widoki*/
+    size_t inline_sources = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (weights[i] != 0 && PolyIsInline(polys[i])) {
+            inline_sources++;
+        }
+    }
+    PolyView *views = NULL;
+    const Poly **expanded = NULL;
+    if (inline_sources > 0) {
+        views = (PolyView *) PoolAlloc(sizeof(PolyView) * count);
+        expanded = (const Poly **) PoolAlloc(sizeof(Poly *) * count);
+        for (size_t i = 0; i < count; ++i) {
+            expanded[i] = PolyIsCoeff(polys[i]) ? polys[i] : PolyViewOf(polys[i], &views[i]);
+        }
+        polys = expanded;
+    }
+
+    HeapEntry *heap = (HeapEntry *) PoolAlloc(sizeof(HeapEntry) * sources);
+    size_t heap_size = 0;
+    size_t capacity = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (weights[i] != 0 && !PolyIsCoeff(polys[i])) {
+            HeapPush(heap, &heap_size, (HeapEntry) {.exp = MonoGetExp(&polys[i]->arr[0]), .i = i, .j = 0});
+            capacity = (polys[i]->size > capacity) ? polys[i]->size : capacity;
+        }
+    }
+    /* grupa współczynników jednomianów o tym samym wykładniku (i ewentualnie współczynnik scalar)*/
+    const Poly **group_polys = (const Poly **) PoolAlloc(sizeof(Poly *) * (sources + 1));
+    poly_coeff_t *group_weights = (poly_coeff_t *) PoolAlloc(sizeof(poly_coeff_t) * (sources + 1));
+    Poly scalar_poly = PolyFromCoeff(scalar);
+
+    Poly result = PolyInit(capacity + 1);
+    result.size = 0;
+    capacity++;
+    if (scalar != 0 && heap[0].exp > 0) {
+        /* najmniejszy wykładnik składników jest dodatni, współczynnik jest osobnym jednomianem*/
+        Mono mono = MonoFromPoly(&scalar_poly, 0);
+        PolyAppendMono(&result, &capacity, &mono);
+        scalar = 0;
+    }
+    while (heap_size > 0) {
+        poly_exp_t exp = heap[0].exp;
+        size_t group_size = 0;
+        if (exp == 0 && scalar != 0) {
+            group_polys[group_size] = &scalar_poly;
+            group_weights[group_size++] = 1;
+        }
+        while (heap_size > 0 && heap[0].exp == exp) {
+            HeapEntry top = HeapPop(heap, &heap_size);
+            const Poly *source = polys[top.i];
+            group_polys[group_size] = &source->arr[top.j].p;
+            group_weights[group_size++] = weights[top.i];
+            if (top.j + 1 < source->size) {
+                HeapPush(heap, &heap_size, (HeapEntry) {
+                        .exp = MonoGetExp(&source->arr[top.j + 1]), .i = top.i, .j = top.j + 1});
+            }
+        }
+        Poly sum = PolyLinComb(group_size, group_polys, group_weights);
+        /* pomijamy zero*/
+        if (!PolyIsZero(&sum)) {
+            Mono mono = MonoFromPoly(&sum, exp);
+            PolyAppendMono(&result, &capacity, &mono);
+        }
+    }
+    PoolFree(heap);
+    PoolFree(group_polys);
+    PoolFree(group_weights);
+    PoolFree(views);
+    PoolFree(expanded);
+
+    /* były tylko zera, nic nie zostało zapisane do wyniku*/
+    if (result.size == 0) {
+        MonosFree(result.arr);
+        return PolyZero();
+    }
+    PolyOptimize(&result);
+    return result;
+}
+
+/**
+ * To jest struktura opisująca kombinację liniową podzieloną na zadania.
+ */
+typedef struct LinCombTasks {
+    size_t size; ///< liczba składników
+    const Poly *const *polys; ///< składniki
+    const poly_coeff_t *weights; ///< wagi składników
+    size_t count; ///< liczba zadań
+    Poly *parts; ///< kombinacje liniowe kolejnych przedziałów składników
+} LinCombTasks;
+
+/**
+ * Liczy kombinację liniową jednego przedziału składników.
+ * @param[in,out] arg : kombinacja liniowa podzielona na zadania
+ * @param[in] index : numer zadania
+ */
+static void LinCombTask(void *arg, size_t index) {
+    LinCombTasks *tasks = arg;
+    size_t begin = tasks->size * index / tasks->count;
+    size_t end = tasks->size * (index + 1) / tasks->count;
+    tasks->parts[index] = PolyLinComb(end - begin, tasks->polys + begin, tasks->weights + begin);
+}
+
+/**
+ * Liczy kombinację liniową jak PolyLinComb, dzieląc składniki na zadania:
+ * każde zadanie liczy kombinację swojego przedziału, a częściowe wyniki
+ * są na końcu sumowane. Daje ten sam wynik co PolyLinComb.
+ * @param[in] count : liczba składników
+ * @param[in] polys : składniki
+ * @param[in] weights : wagi składników
+ * @return kombinacja liniowa składników
+ */
+static Poly PolyLinCombTasks(size_t count, const Poly *const polys[], const poly_coeff_t weights[]) {
+    LinCombTasks tasks = {.size = count, .polys = polys, .weights = weights, .count = TaskCount(count)};
+    tasks.parts = (Poly *) PoolAlloc(sizeof(Poly) * tasks.count);
+    SchedulerParallelFor(tasks.count, LinCombTask, &tasks);
+    const Poly **parts = (const Poly **) PoolAlloc(sizeof(Poly *) * tasks.count);
+    poly_coeff_t *ones = (poly_coeff_t *) PoolAlloc(sizeof(poly_coeff_t) * tasks.count);
+    for (size_t i = 0; i < tasks.count; ++i) {
+        parts[i] = &tasks.parts[i];
+        ones[i] = 1;
+    }
+    Poly result = PolyLinComb(tasks.count, parts, ones);
+    for (size_t i = 0; i < tasks.count; ++i) {
+        PolyDestroy(&tasks.parts[i]);
+    }
+    PoolFree(tasks.parts);
+    PoolFree(parts);
+    PoolFree(ones);
+    return result;
+}
+
+Poly PolyAddMany(size_t count, const Poly ps[]) {
+    const Poly **polys = (const Poly **) PoolAlloc(sizeof(Poly *) * (count + 1));
+    poly_coeff_t *ones = (poly_coeff_t *) PoolAlloc(sizeof(poly_coeff_t) * (count + 1));
+    size_t monos = 0;
+    for (size_t i = 0; i < count; ++i) {
+        polys[i] = &ps[i];
+        ones[i] = 1;
+        monos += PolyHasMonos(&ps[i]) ? ps[i].size : 1;
+    }
+    /* składniki dzielimy na zadania tak jak jednomiany w PolyUseTasks*/
+    bool use_tasks = SchedulerThreads() > 1 && count >= 2 && monos >= TASK_MIN_MONOS;
+    Poly result = use_tasks ? PolyLinCombTasks(count, polys, ones) : PolyLinComb(count, polys, ones);
+    PoolFree(polys);
+    PoolFree(ones);
+    return result;
+}
+
 Poly PolyAt(const Poly *p, poly_coeff_t x) {
     if (PolyIsCoeff(p)) {
         return PolyClone(p);
     }
+    if (PolyIsInline(p)) {
+        return PolyFromCoeff(p->coeff * Power(x, PolyInlineExp(p)));
+    }
     /* Jednomiany w wielomianie są zawsze sortowane według wykładników. Aby uniknąć liczenia x^n dla
      * każdego jednomianu w wielomianie, liczymy x^n dla bieżącego jednomianu i różnicę m-n(następny
      * jednomian ma większy wykładnik m). Więc x^m = x^n * x^(m-n)*/
+    bool only_coeffs = true;
+    for (size_t i = 0; i < p->size && only_coeffs; ++i) {
+        only_coeffs = PolyIsCoeff(&p->arr[i].p);
+    }
     poly_coeff_t x_power_value = 1;
     poly_exp_t current_exp = 0;
-    Poly result = PolyZero();
+    if (only_coeffs) {
+        /* wynik jest współczynnikiem, liczymy go bez przydzielania pamięci*/
+        poly_coeff_t result = 0;
+        for (size_t i = 0; i < p->size; ++i) {
+            poly_exp_t previous_exp = current_exp;
+            current_exp = MonoGetExp(&p->arr[i]);
+            x_power_value *= Power(x, current_exp - previous_exp);
+            result += p->arr[i].p.coeff * x_power_value;
+        }
+        return PolyFromCoeff(result);
+    }
+
+    /* wynik to kombinacja liniowa współczynników jednomianów z wagami x^n*/
+    const Poly **polys = (const Poly **) PoolAlloc(sizeof(Poly *) * p->size);
+    poly_coeff_t *weights = (poly_coeff_t *) PoolAlloc(sizeof(poly_coeff_t) * p->size);
     for (size_t i = 0; i < p->size; ++i) {
         poly_exp_t previous_exp = current_exp;
         current_exp = MonoGetExp(&p->arr[i]);
 
-        /* m - n*/
-        poly_exp_t exp_difference = current_exp - previous_exp;
-
         /* x^n * x^(m - n)*/
-        x_power_value *= Power(x, exp_difference);
+        x_power_value *= Power(x, current_exp - previous_exp);
 
-        Poly current_mono_evaluated;
-        if (PolyIsCoeff(&p->arr[i].p)) {
-            current_mono_evaluated = CoefMulCoef(p->arr[i].p.coeff, x_power_value);
+        polys[i] = &p->arr[i].p;
+        weights[i] = x_power_value;
+    }
+    Poly result = PolyUseTasks(p) ? PolyLinCombTasks(p->size, polys, weights)
+                                  : PolyLinComb(p->size, polys, weights);
+    PoolFree(polys);
+    PoolFree(weights);
+    return result;
+}
+
+/** Liczba punktów przetwarzanych razem przez PolyAtMany */
+#define AT_MANY_BLOCK 64
+
+/**
+ * Mnoży potęgi punktów przez punkty podniesione do potęgi @p exp:
+ * @f$powers_k \cdot xs_k^{exp}@f$. Potęgowanie przez podnoszenie do kwadratu
+ * przebiega jednocześnie dla wszystkich punktów, więc pętle wewnętrzne
+ * idą po punktach i dają się wektoryzować.
+ * @param[in] count : liczba punktów, nie większa niż AT_MANY_BLOCK
+ * @param[in] xs : punkty
+ * @param[in] exp : wykładnik
+ * @param[in,out] powers : potęgi punktów
+ */
+static void PowerMany(size_t count, const poly_coeff_t xs[], poly_exp_t exp, poly_coeff_t powers[]) {
+    if (exp == 1) {
+        for (size_t k = 0; k < count; ++k) {
+            powers[k] *= xs[k];
+        }
+        return;
+    }
+    poly_coeff_t base[AT_MANY_BLOCK];
+    memcpy(base, xs, sizeof(poly_coeff_t) * count);
+    while (exp > 0) {
+        if ((exp & 1) != 0) {
+            for (size_t k = 0; k < count; ++k) {
+                powers[k] *= base[k];
+            }
+        }
+        exp = exp >> 1;
+        for (size_t k = 0; k < count; ++k) {
+            base[k] *= base[k];
+        }
+    }
+}
+
+void PolyAtMany(const Poly *p, size_t n, const poly_coeff_t xs[], Poly out[]) {
+    if (PolyIsCoeff(p)) {
+        for (size_t k = 0; k < n; ++k) {
+            out[k] = PolyClone(p);
+        }
+        return;
+    }
+    PolyView view;
+    p = PolyViewOf(p, &view);
+    bool only_coeffs = true;
+    for (size_t i = 0; i < p->size && only_coeffs; ++i) {
+        only_coeffs = PolyIsCoeff(&p->arr[i].p);
+    }
+    const Poly **polys = NULL;
+    poly_coeff_t *weights = NULL;
+    if (!only_coeffs) {
+        polys = (const Poly **) PoolAlloc(sizeof(Poly *) * p->size);
+        weights = (poly_coeff_t *) PoolAlloc(sizeof(poly_coeff_t) * p->size * AT_MANY_BLOCK);
+        for (size_t i = 0; i < p->size; ++i) {
+            polys[i] = &p->arr[i].p;
+        }
+    }
+    /* punkty przetwarzamy blokami, w bloku przechodzimy jednomiany raz dla wszystkich punktów*/
+    for (size_t start = 0; start < n; start += AT_MANY_BLOCK) {
+        size_t count = (n - start < AT_MANY_BLOCK) ? n - start : AT_MANY_BLOCK;
+        const poly_coeff_t *block = xs + start;
+        poly_coeff_t powers[AT_MANY_BLOCK];
+        poly_coeff_t values[AT_MANY_BLOCK];
+        for (size_t k = 0; k < count; ++k) {
+            powers[k] = 1;
+            values[k] = 0;
+        }
+        poly_exp_t current_exp = 0;
+        for (size_t i = 0; i < p->size; ++i) {
+            poly_exp_t previous_exp = current_exp;
+            current_exp = MonoGetExp(&p->arr[i]);
+            /* x^m = x^n * x^(m - n) dla każdego punktu*/
+            PowerMany(count, block, current_exp - previous_exp, powers);
+            if (only_coeffs) {
+                poly_coeff_t coeff = p->arr[i].p.coeff;
+                for (size_t k = 0; k < count; ++k) {
+                    values[k] += coeff * powers[k];
+                }
+            } else {
+                for (size_t k = 0; k < count; ++k) {
+                    weights[k * p->size + i] = powers[k];
+                }
+            }
+        }
+        for (size_t k = 0; k < count; ++k) {
+            if (only_coeffs) {
+                out[start + k] = PolyFromCoeff(values[k]);
+            } else {
+                out[start + k] = PolyLinComb(p->size, polys, weights + k * p->size);
+            }
+        }
+    }
+    PoolFree(polys);
+    PoolFree(weights);
+}
+
+/**
+ * Liczba zmiennych, dla których PolyEval trzyma tablice potęg na stosie.
+ * Potęgi dalszych zmiennych są liczone bez tablic.
+ */
+#define EVAL_TABLE_VARS 32
+
+/**
+ * Tablica kolejnych kwadratów wartości zmiennej:
+ * @f$squares_k = x^{2^k}@f$. Jest uzupełniana leniwie i współdzielona
+ * przez wszystkie jednomiany tej zmiennej w całym wielomianie.
+ */
+typedef struct SquareTable {
+    poly_coeff_t squares[sizeof(poly_exp_t) * CHAR_BIT]; ///< kwadraty wartości zmiennej
+    size_t count; ///< liczba wyliczonych kwadratów
+} SquareTable;
+
+/**
+ * Wylicza potęgę wartości zmiennej, korzystając z tablicy kwadratów
+ * i uzupełniając ją w razie potrzeby.
+ * @param[in,out] table : tablica kwadratów zmiennej
+ * @param[in] exp : wykładnik
+ * @return @f$x^{exp}@f$
+ */
+static poly_coeff_t SquareTablePower(SquareTable *table, poly_exp_t exp) {
+    poly_coeff_t result = 1;
+    for (size_t k = 0; exp > 0; ++k) {
+        if (k == table->count) {
+            table->squares[k] = table->squares[k - 1] * table->squares[k - 1];
+            table->count++;
+        }
+        if ((exp & 1) != 0) {
+            result *= table->squares[k];
+        }
+        exp = exp >> 1;
+    }
+    return result;
+}
+
+/**
+ * Wylicza wartość wielomianu zmiennych @f$x_{var\_idx}, x_{var\_idx + 1}, \ldots@f$.
+ * @param[in] p : wielomian
+ * @param[in] var_idx : indeks zmiennej wielomianu @p p
+ * @param[in] nvars : liczba podanych wartości zmiennych
+ * @param[in] xs : wartości zmiennych
+ * @param[in,out] tables : tablice kwadratów pierwszych EVAL_TABLE_VARS zmiennych
+ * @return wartość wielomianu
+ */
+static poly_coeff_t PolyEvalHelper(const Poly *p, size_t var_idx, size_t nvars,
+                                   const poly_coeff_t xs[], SquareTable tables[]) {
+    if (PolyIsCoeff(p)) {
+        return p->coeff;
+    }
+    if (PolyIsInline(p)) {
+        /* wykładnik jest dodatni*/
+        if (var_idx >= nvars || xs[var_idx] == 0) {
+            return 0;
+        }
+        if (var_idx < EVAL_TABLE_VARS) {
+            return p->coeff * SquareTablePower(&tables[var_idx], PolyInlineExp(p));
+        }
+        return p->coeff * Power(xs[var_idx], PolyInlineExp(p));
+    }
+    if (var_idx >= nvars || xs[var_idx] == 0) {
+        /* zostaje tylko jednomian o wykładniku 0, jeśli istnieje, jest pierwszy*/
+        if (MonoGetExp(&p->arr[0]) != 0) {
+            return 0;
+        }
+        return PolyEvalHelper(&p->arr[0].p, var_idx + 1, nvars, xs, tables);
+    }
+    poly_coeff_t result = 0;
+    poly_coeff_t x_power_value = 1;
+    poly_exp_t current_exp = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        poly_exp_t previous_exp = current_exp;
+        current_exp = MonoGetExp(&p->arr[i]);
+        /* x^m = x^n * x^(m - n)*/
+        if (var_idx < EVAL_TABLE_VARS) {
+            x_power_value *= SquareTablePower(&tables[var_idx], current_exp - previous_exp);
         } else {
-            current_mono_evaluated = PolyMulCoef(&p->arr[i].p, x_power_value);
+            x_power_value *= Power(xs[var_idx], current_exp - previous_exp);
         }
-        Poly new_result = PolyAdd(&current_mono_evaluated, &result);
+        result += PolyEvalHelper(&p->arr[i].p, var_idx + 1, nvars, xs, tables) * x_power_value;
+    }
+    return result;
+}
+
+poly_coeff_t PolyEval(const Poly *p, size_t nvars, const poly_coeff_t xs[]) {
+    SquareTable tables[EVAL_TABLE_VARS];
+    for (size_t i = 0; i < nvars && i < EVAL_TABLE_VARS; ++i) {
+        tables[i].squares[0] = xs[i];
+        tables[i].count = 1;
+    }
+    return PolyEvalHelper(p, 0, nvars, xs, tables);
+}
 
-        PolyDestroy(&result);
-        PolyDestroy(&current_mono_evaluated);
+void PolyCompile(const Poly *p) {
+    if (!PolyHasMonos(p) || atomic_load(&PolyHeader(p)->plan) != NULL) {
+        return;
+    }
+    PolyPlan *plan = PlanCompile(p);
+    PolyPlan *expected = NULL;
+    if (!atomic_compare_exchange_strong(&PolyHeader(p)->plan, &expected, plan)) {
+        /* inny wątek zapisał już taki sam plan*/
+        PlanDestroy(plan);
+    }
+}
 
-        result = new_result;
+void PolyEvalMany(const Poly *p, size_t n, size_t nvars, const poly_coeff_t xs[], poly_coeff_t out[]) {
+    if (!PolyHasMonos(p)) {
+        /* współczynnik lub jednomian bez tablicy nie potrzebuje planu*/
+        for (size_t k = 0; k < n; ++k) {
+            out[k] = PolyEval(p, nvars, xs + k * nvars);
+        }
+        return;
     }
+    PolyCompile(p);
+    PlanEval(atomic_load(&PolyHeader(p)->plan), n, nvars, xs, out);
+}
+
+Poly PolyAtOwn(Poly *p, poly_coeff_t x) {
+    Poly result = PolyAt(p, x);
+    PolyDestroy(p);
     return result;
 }
 
@@ -595,6 +2984,8 @@ void PolyPrint(const Poly *p) {
     if (PolyIsCoeff(p)) {
         printf("%ld", p->coeff);
     } else {
+        PolyView view;
+        p = PolyViewOf(p, &view);
         assert(p->size > 0);
         MonoPrint(&p->arr[0]);
         for (size_t i = 1; i < p->size; ++i) {
@@ -605,63 +2996,299 @@ void PolyPrint(const Poly *p) {
 }
 
 /**
- * Wylicza @f$exp@f$-tą potęgę wielomianu @f$p@f$.
- * @param[in] p : wielomian
+ * Pamięć podręczna potęg wielomianu. Przechowuje wyliczone już potęgi
+ * posortowane według wykładnika. Jest współdzielona przez całe składanie
+ * wielomianów, więc każda potęga jest liczona co najwyżej raz.
+ */
+typedef struct PowerCache {
+    const Poly *base; ///< podstawa potęg
+    size_t size; ///< liczba zapamiętanych potęg
+    size_t capacity; ///< pojemność tablic
+    poly_exp_t *exps; ///< posortowane rosnąco wykładniki zapamiętanych potęg
+    Poly *powers; ///< zapamiętane potęgi, @p powers[i] to @p base do potęgi @p exps[i]
+} PowerCache;
+
+/** Początkowa pojemność pamięci podręcznej potęg */
+#define POWER_CACHE_INIT_CAPACITY 8
+
+/**
+ * Tworzy pustą pamięć podręczną potęg wielomianu.
+ * @param[in] base : podstawa potęg
+ * @return pamięć podręczna potęg
+ */
+static PowerCache PowerCacheCreate(const Poly *base) {
+    return (PowerCache) {
+            .base = base, .size = 0, .capacity = POWER_CACHE_INIT_CAPACITY,
+            .exps = (poly_exp_t *) PoolAlloc(sizeof(poly_exp_t) * POWER_CACHE_INIT_CAPACITY),
+            .powers = (Poly *) PoolAlloc(sizeof(Poly) * POWER_CACHE_INIT_CAPACITY)};
+}
+
+/**
+ * Usuwa pamięć podręczną potęg razem z zapamiętanymi potęgami.
+ * @param[in,out] cache : pamięć podręczna potęg
+ */
+static void PowerCacheDestroy(PowerCache *cache) {
+    for (size_t i = 0; i < cache->size; ++i) {
+        PolyDestroy(&cache->powers[i]);
+    }
+    PoolFree(cache->exps);
+    PoolFree(cache->powers);
+}
+
+/**
+ * Wyszukuje binarnie pozycję wykładnika w pamięci podręcznej potęg.
+ * @param[in] cache : pamięć podręczna potęg
+ * @param[in] exp : wykładnik
+ * @return liczba zapamiętanych potęg o wykładniku mniejszym niż @p exp
+ */
+static size_t PowerCacheFind(const PowerCache *cache, poly_exp_t exp) {
+    size_t low = 0;
+    size_t high = cache->size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (cache->exps[middle] < exp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * Wylicza @f$exp@f$-tą potęgę podstawy pamięci podręcznej i zapamiętuje ją.
+ * Potęga jest budowana z już zapamiętanych potęg: jeśli największy
+ * zapamiętany wykładnik @f$k < exp@f$ spełnia @f$2k \geq exp@f$, to
+ * @f$base^{exp} = base^k \cdot base^{exp - k}@f$, w przeciwnym razie
+ * potęga jest liczona przez podnoszenie do kwadratu @f$base^{\lfloor exp/2 \rfloor}@f$.
+ * Dla rosnącego ciągu wykładników kolejne potęgi powstają więc zwykle
+ * jednym mnożeniem z poprzednich.
+ * @param[in,out] cache : pamięć podręczna potęg
  * @param[in] exp : wykładnik @f$exp@f$
- * @return @f$p^{exp}@f$
+ * @return @f$base^{exp}@f$
  */
-Poly PolyPow(const Poly *p, poly_exp_t exp) {
-    Poly temp;
-    if (exp == 0)
+static Poly PowerCacheGet(PowerCache *cache, poly_exp_t exp) {
+    if (exp == 0) {
         return PolyFromCoeff(1);
-    temp = PolyPow(p, exp / 2);
-    Poly result = PolyMul(&temp, &temp);
-    PolyDestroy(&temp);
-    if (exp % 2 == 0) {
-        return result;
+    }
+    if (exp == 1) {
+        return PolyClone(cache->base);
+    }
+    size_t position = PowerCacheFind(cache, exp);
+    if (position < cache->size && cache->exps[position] == exp) {
+        return PolyClone(&cache->powers[position]);
+    }
+
+    Poly result;
+    poly_exp_t previous = (position > 0) ? cache->exps[position - 1] : 0;
+    if (previous >= exp - previous) {
+        Poly lhs = PowerCacheGet(cache, previous);
+        Poly rhs = PowerCacheGet(cache, exp - previous);
+        result = PolyMulOwnHelper(&lhs, &rhs);
     } else {
-        Poly poly = PolyMul(p, &result);
-        PolyDestroy(&result);
-        return poly;
+        Poly half = PowerCacheGet(cache, exp / 2);
+        result = PolyMulHelper(&half, &half);
+        PolyDestroy(&half);
+        if (exp % 2 != 0) {
+            Poly base = PolyClone(cache->base);
+            result = PolyMulOwnHelper(&result, &base);
+        }
+    }
+
+    /* rekurencja mogła dodać nowe potęgi, więc szukamy pozycji ponownie */
+    position = PowerCacheFind(cache, exp);
+    if (cache->size == cache->capacity) {
+        cache->capacity *= 2;
+        cache->exps = (poly_exp_t *) PoolRealloc(cache->exps, sizeof(poly_exp_t) * cache->capacity);
+        cache->powers = (Poly *) PoolRealloc(cache->powers, sizeof(Poly) * cache->capacity);
     }
+    memmove(cache->exps + position + 1, cache->exps + position,
+            sizeof(poly_exp_t) * (cache->size - position));
+    memmove(cache->powers + position + 1, cache->powers + position,
+            sizeof(Poly) * (cache->size - position));
+    cache->exps[position] = exp;
+    cache->powers[position] = PolyClone(&result);
+    cache->size++;
+    return result;
 }
 
-Poly PolyCompose(const Poly *p, size_t count, const Poly q[]) {
+/** Najmniejsza liczba jednomianów na dwóch najwyższych poziomach, od której składanie dzieli pracę na zadania */
+#define COMPOSE_TASK_MIN_MONOS 64
+
+static Poly PolyComposeHelper(const Poly *p, size_t count, const Poly q[], PowerCache caches[]);
+
+/**
+ * Składa jeden jednomian wielomianu: składa jego współczynnik z dalszymi
+ * wielomianami i mnoży wynik przez potęgę @p q[0].
+ * @param[in] m : jednomian
+ * @param[in] count : liczba wielomianów, co najmniej 1
+ * @param[in] q : tablica wielomianów
+ * @param[in,out] caches : pamięci podręczne potęg dalszych wielomianów
+ * @param[in,out] powers : pamięć podręczna potęg @p q[0]
+ * @return złożenie jednomianu
+ */
+static Poly MonoCompose(const Mono *m, size_t count, const Poly q[], PowerCache caches[], PowerCache *powers) {
+    Poly inner_compose = PolyComposeHelper(&m->p, (count > 1) ? count - 1 : 0, q + (count > 1), caches);
+    if (PolyIsZero(&inner_compose)) {
+        return PolyZero();
+    }
+    Poly poly_pow = PowerCacheGet(powers, MonoGetExp(m));
+    return PolyMulOwnHelper(&inner_compose, &poly_pow);
+}
+
+/**
+ * To jest struktura opisująca składanie jednomianów podzielone na zadania.
+ */
+typedef struct ComposeTasks {
+    const Poly *p; ///< składany wielomian
+    size_t count; ///< liczba wielomianów
+    const Poly *q; ///< tablica wielomianów
+    PowerCache *caches; ///< pamięci podręczne potęg @p q z już policzonymi potęgami
+    Poly *terms; ///< złożenia kolejnych jednomianów
+    size_t tasks; ///< liczba zadań
+} ComposeTasks;
+
+/**
+ * Składa jednomiany z jednego przedziału. Wszystkie potrzebne potęgi są
+ * już w pamięciach podręcznych, więc zadania je tylko odczytują.
+ * @param[in,out] arg : składanie podzielone na zadania
+ * @param[in] index : numer zadania
+ */
+static void ComposeTask(void *arg, size_t index) {
+    ComposeTasks *tasks = arg;
+    size_t size = tasks->p->size;
+    for (size_t i = size * index / tasks->tasks; i < size * (index + 1) / tasks->tasks; ++i) {
+        tasks->terms[i] = MonoCompose(&tasks->p->arr[i], tasks->count, tasks->q,
+                                      tasks->caches + (tasks->count > 1), &tasks->caches[0]);
+    }
+}
+
+/**
+ * Wylicza do pamięci podręcznych wszystkie potęgi, których użyje złożenie
+ * wielomianu: potęgi @p q[0] dla wykładników jednomianów @p p, potęgi
+ * @p q[1] dla wykładników jednomianów ich współczynników i tak dalej.
+ * @param[in] p : wielomian
+ * @param[in] count : liczba wielomianów
+ * @param[in,out] caches : pamięci podręczne potęg, @p caches[i] dla @p q[i]
+ */
+static void PowerCachePrefill(const Poly *p, size_t count, PowerCache caches[]) {
+    if (PolyIsCoeff(p) || count == 0) {
+        return;
+    }
+    PolyView view;
+    p = PolyViewOf(p, &view);
+    for (size_t i = 0; i < p->size; i++) {
+        Poly poly_pow = PowerCacheGet(&caches[0], MonoGetExp(&p->arr[i]));
+        PolyDestroy(&poly_pow);
+        PowerCachePrefill(&p->arr[i].p, count - 1, caches + 1);
+    }
+}
+
+/**
+ * Sprawdza, czy składanie wielomianu opłaca się podzielić na zadania.
+ * Złożenie każdego jednomianu wymaga mnożenia wielomianów, więc próg jest
+ * znacznie niższy niż w PolyUseTasks.
+ * @param[in] p : wielomian z tablicą jednomianów
+ * @return Czy dzielić składanie na zadania?
+ */
+static bool PolyComposeUseTasks(const Poly *p) {
+    if (SchedulerThreads() <= 1 || p->size < 2) {
+        return false;
+    }
+    size_t monos = p->size;
+    for (size_t i = 0; i < p->size && monos < COMPOSE_TASK_MIN_MONOS; ++i) {
+        const Poly *coeff = &p->arr[i].p;
+        monos += (!PolyIsCoeff(coeff) && !PolyIsInline(coeff)) ? coeff->size : 1;
+    }
+    return monos >= COMPOSE_TASK_MIN_MONOS;
+}
+
+/**
+ * Składa wielomiany, tak jak PolyCompose, korzystając z pamięci podręcznych
+ * potęg wielomianów @p q. Na kilku wątkach złożenia jednomianów dużego
+ * wielomianu są liczone jako osobne zadania: potrzebne potęgi wszystkich
+ * wielomianów @p q są najpierw liczone po kolei, a zadania współdzielą
+ * pamięci podręczne tylko do odczytu. Złożenia jednomianów są sumowane jednym
+ * scaleniem przez PolyAddMany.
+ * @param[in] p : wielomian
+ * @param[in] count : liczba wielomianów
+ * @param[in] q : tablica wielomianów
+ * @param[in,out] caches : pamięci podręczne potęg, @p caches[i] dla @p q[i]
+ * @return @f$p(q[0], q[1], .., q[count - 1], 0, 0 \ldots, 0)@f$
+ */
+static Poly PolyComposeHelper(const Poly *p, size_t count, const Poly q[], PowerCache caches[]) {
     if (PolyIsCoeff(p)) {
         return *p;
     }
     if (count == 0) {
         Poly result = PolyClone(p);
-        Poly temp;
         do {
-            temp = result;
-            result = PolyAt(&temp, 0);
-            PolyDestroy(&temp);
+            result = PolyAtOwn(&result, 0);
         } while (!PolyIsCoeff(&result));
         return result;
     }
-    Poly *temp = malloc(p->size * sizeof(Poly));
-    if (temp == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
-    for (size_t i = 0; i < p->size; i++) {
-        Poly inner_compose = PolyCompose(&p->arr[i].p, (count > 1) ? count - 1 : 0, q + (count > 1));
-        if (PolyIsZero(&inner_compose)) {
-            temp[i] = PolyZero();
-        } else {
-            Poly poly_pow = PolyPow(&q[0], p->arr[i].exp);
-            temp[i] = PolyMul(&inner_compose, &poly_pow);
-            PolyDestroy(&poly_pow);
+    PolyView view;
+    p = PolyViewOf(p, &view);
+    Poly *temp = PoolAlloc(p->size * sizeof(Poly));
+    if (PolyComposeUseTasks(p)) {
+        /* zadania tylko odczytują pamięci podręczne potęg, więc wypełniamy je wcześniej*/
+        PowerCachePrefill(p, count, caches);
+        ComposeTasks tasks = {.p = p, .count = count, .q = q, .caches = caches, .terms = temp,
+                              .tasks = TaskCount(p->size)};
+        SchedulerParallelFor(tasks.tasks, ComposeTask, &tasks);
+    } else {
+        for (size_t i = 0; i < p->size; i++) {
+            temp[i] = MonoCompose(&p->arr[i], count, q, caches + (count > 1), &caches[0]);
         }
-        PolyDestroy(&inner_compose);
     }
-    Poly result = temp[0];
-    for (size_t i = 1; i < p->size; i++) {
-        Poly temp_res = PolyAdd(&result, &temp[i]);
-        PolyDestroy(&result);
-        result = temp_res;
+    Poly result = PolyAddMany(p->size, temp);
+    for (size_t i = 0; i < p->size; i++) {
         PolyDestroy(&temp[i]);
     }
-    free(temp);
+    PoolFree(temp);
+    return result;
+}
+
+/**
+ * Składa wielomian bez pamięci podręcznej wyników.
+ * @param[in] p : wielomian
+ * @param[in] count : liczba wielomianów
+ * @param[in] q : tablica wielomianów
+ * @return złożenie wielomianu
+ */
+static Poly PolyComposeAll(const Poly *p, size_t count, const Poly q[]) {
+    if (count == 0) {
+        return PolyComposeHelper(p, count, q, NULL);
+    }
+    PowerCache *caches = PoolAlloc(count * sizeof(PowerCache));
+    for (size_t i = 0; i < count; ++i) {
+        caches[i] = PowerCacheCreate(&q[i]);
+    }
+    Poly result = PolyComposeHelper(p, count, q, caches);
+    for (size_t i = 0; i < count; ++i) {
+        PowerCacheDestroy(&caches[i]);
+    }
+    PoolFree(caches);
+    return result;
+}
+
+Poly PolyCompose(const Poly *p, size_t count, const Poly q[]) {
+    if (!ResultCacheEnabled() || PolyIsCoeff(p)) {
+        return PolyComposeAll(p, count, q);
+    }
+    Poly *args = PoolAlloc(sizeof(Poly) * (count + 1));
+    args[0] = *p;
+    memcpy(args + 1, q, sizeof(Poly) * count);
+    uint64_t key = ResultKey(RESULT_COMPOSE, count + 1, args);
+    Poly result;
+    if (!ResultFind(RESULT_COMPOSE, key, count + 1, args, &result)) {
+        result = PolyComposeAll(p, count, q);
+        ResultStore(RESULT_COMPOSE, key, count + 1, args, &result);
+    }
+    PoolFree(args);
     return result;
-}
\ No newline at end of file
+}
+
+void PolySetThreads(size_t count) {
+    SchedulerSetThreads(count);
+}
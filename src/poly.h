@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /** To jest typ reprezentujący współczynniki. */
 typedef long poly_coeff_t;
@@ -25,12 +26,18 @@ struct Mono;
  * To jest struktura przechowująca wielomian.
  * Wielomian jest albo liczbą całkowitą, czyli wielomianem stałym
  * (wtedy `arr == NULL`), albo niepustą listą jednomianów (wtedy `arr != NULL`).
+ * Jednomian @f$cx_i^n@f$, którego współczynnik @f$c@f$ jest liczbą, może być
+ * zapisany bez tablicy jednomianów (zob. PolyIsInline): wtedy `coeff` to
+ * @f$c@f$, a w `arr` zakodowany jest wykładnik @f$n@f$ z ustawionym
+ * najmłodszym bitem.
  */
 typedef struct Poly {
     /**
     * To jest unia przechowująca współczynnik wielomianu lub
     * liczbę jednomianów w wielomianie.
     * Jeżeli `arr == NULL`, wtedy jest to współczynnik będący liczbą całkowitą.
+    * Jeżeli wielomian jest jednomianem zapisanym bez tablicy, jest to
+    * współczynnik tego jednomianu.
     * W przeciwnym przypadku jest to niepusta lista jednomianów.
     */
     union {
@@ -114,6 +121,38 @@ static inline bool PolyIsZero(const Poly *p) {
     return PolyIsCoeff(p) && p->coeff == 0;
 }
 
+/**
+ * Sprawdza, czy wielomian jest jednomianem @f$cx_i^n@f$ o współczynniku
+ * będącym liczbą, zapisanym bez tablicy jednomianów. Taki wielomian nie
+ * zajmuje pamięci poza samą strukturą.
+ * @param[in] p : wielomian
+ * @return Czy wielomian jest jednomianem zapisanym bez tablicy?
+ */
+static inline bool PolyIsInline(const Poly *p) {
+    return ((uintptr_t) p->arr & 1) != 0;
+}
+
+/**
+ * Daje wykładnik jednomianu zapisanego bez tablicy.
+ * @param[in] p : wielomian, dla którego PolyIsInline jest prawdą
+ * @return wykładnik jednomianu
+ */
+static inline poly_exp_t PolyInlineExp(const Poly *p) {
+    assert(PolyIsInline(p));
+    return (poly_exp_t) ((uintptr_t) p->arr >> 1);
+}
+
+/**
+ * Tworzy jednomian @f$cx_i^n@f$ zapisany bez tablicy jednomianów.
+ * @param[in] c : niezerowy współczynnik
+ * @param[in] n : dodatni wykładnik
+ * @return wielomian @f$cx_i^n@f$
+ */
+static inline Poly PolyFromInline(poly_coeff_t c, poly_exp_t n) {
+    assert(c != 0 && n > 0);
+    return (Poly) {.coeff = c, .arr = (struct Mono *) (((uintptr_t) n << 1) | 1)};
+}
+
 /**
  * Usuwa wielomian z pamięci.
  * @param[in] p : wielomian
@@ -129,14 +168,18 @@ static inline void MonoDestroy(Mono *m) {
 }
 
 /**
- * Robi pełną, głęboką kopię wielomianu.
+ * Robi kopię wielomianu w czasie stałym. Kopia współdzieli tablicę
+ * jednomianów z oryginałem (zwiększa jej licznik referencji). Tablica jest
+ * kopiowana dopiero wtedy, gdy któraś z operacji przejmujących argument
+ * na własność chce ją zmodyfikować, więc kopia zachowuje się jak pełna,
+ * niezależna kopia.
  * @param[in] p : wielomian
  * @return skopiowany wielomian
  */
 Poly PolyClone(const Poly *p);
 
 /**
- * Robi pełną, głęboką kopię jednomianu.
+ * Robi kopię jednomianu w czasie stałym (zob. PolyClone).
  * @param[in] m : jednomian
  * @return skopiowany jednomian
  */
@@ -152,6 +195,27 @@ static inline Mono MonoClone(const Mono *m) {
  */
 Poly PolyAdd(const Poly *p, const Poly *q);
 
+/**
+ * Dodaje dwa wielomiany.
+ * Przejmuje na własność zawartość struktur wskazywanych przez @p p i @p q.
+ * Tablice jednomianów i współczynniki argumentów są używane ponownie w wyniku,
+ * zamiast być kopiowane.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p + q@f$
+ */
+Poly PolyAddOwn(Poly *p, Poly *q);
+
+/**
+ * Dodaje wiele wielomianów w jednym przebiegu. Listy jednomianów składników
+ * są scalane kopcem osobno na każdym poziomie, bez wyników pośrednich.
+ * Jeśli @p count jest równe zeru, tworzy wielomian tożsamościowo równy zeru.
+ * @param[in] count : liczba wielomianów
+ * @param[in] ps : tablica wielomianów
+ * @return @f$ps[0] + ps[1] + \ldots + ps[count - 1]@f$
+ */
+Poly PolyAddMany(size_t count, const Poly ps[]);
+
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian.
  * Przejmuje na własność zawartość tablicy @p monos.
@@ -192,6 +256,16 @@ Poly PolyCloneMonos(size_t count, const Mono monos[]);
  */
 Poly PolyMul(const Poly *p, const Poly *q);
 
+/**
+ * Mnoży dwa wielomiany.
+ * Przejmuje na własność zawartość struktur wskazywanych przez @p p i @p q.
+ * Mnożenie przez współczynnik odbywa się w miejscu.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p * q@f$
+ */
+Poly PolyMulOwn(Poly *p, Poly *q);
+
 /**
  * Zwraca przeciwny wielomian.
  * @param[in] p : wielomian @f$p@f$
@@ -199,6 +273,14 @@ Poly PolyMul(const Poly *p, const Poly *q);
  */
 Poly PolyNeg(const Poly *p);
 
+/**
+ * Zwraca przeciwny wielomian, negując współczynniki w miejscu.
+ * Przejmuje na własność zawartość struktury wskazywanej przez @p p.
+ * @param[in] p : wielomian @f$p@f$
+ * @return @f$-p@f$
+ */
+Poly PolyNegOwn(Poly *p);
+
 /**
  * Odejmuje wielomian od wielomianu.
  * @param[in] p : wielomian @f$p@f$
@@ -207,6 +289,15 @@ Poly PolyNeg(const Poly *p);
  */
 Poly PolySub(const Poly *p, const Poly *q);
 
+/**
+ * Odejmuje wielomian od wielomianu.
+ * Przejmuje na własność zawartość struktur wskazywanych przez @p p i @p q.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p - q@f$
+ */
+Poly PolySubOwn(Poly *p, Poly *q);
+
 /**
  * Zwraca stopień wielomianu ze względu na zadaną zmienną (-1 dla wielomianu
  * tożsamościowo równego zeru). Zmienne indeksowane są od 0.
@@ -234,6 +325,36 @@ poly_exp_t PolyDeg(const Poly *p);
  */
 bool PolyIsEq(const Poly *p, const Poly *q);
 
+/**
+ * Daje 64-bitowy skrót struktury wielomianu. Równe wielomiany mają równe
+ * skróty, niezależnie od sposobu zapisu jednomianów. Skrót jest liczony
+ * przy pierwszym wywołaniu i zapamiętywany w węzłach drzewa.
+ * @param[in] p : wielomian
+ * @return skrót wielomianu
+ */
+uint64_t PolyHash(const Poly *p);
+
+/**
+ * Włącza lub wyłącza tryb węzłów wspólnych. W tym trybie PolyIntern
+ * zastępuje każdy węzeł drzewa wielomianu równym węzłem z globalnej
+ * tablicy, więc równe poddrzewa zajmują pamięć tylko raz, a równość
+ * wspólnych węzłów sprawdza się porównaniem wskaźników. Domyślnie tryb
+ * jest wyłączony.
+ * @param[in] enabled : Czy włączyć tryb węzłów wspólnych?
+ */
+void PolySetHashConsing(bool enabled);
+
+/**
+ * Zastępuje węzły wielomianu węzłami wspólnymi, jeśli włączony jest tryb
+ * węzłów wspólnych (zob. PolySetHashConsing). Poddrzewa współdzielone
+ * z innymi wielomianami zostają bez zmian, zamiast być kopiowane.
+ * Poza trybem węzłów wspólnych zwraca wielomian bez zmian.
+ * Przejmuje na własność zawartość struktury wskazywanej przez @p p.
+ * @param[in] p : wielomian
+ * @return wielomian równy @p p
+ */
+Poly PolyIntern(Poly *p);
+
 /**
  * Wylicza wartość wielomianu w punkcie @p x.
  * Wstawia pod pierwszą zmienną wielomianu wartość @p x.
@@ -247,6 +368,65 @@ bool PolyIsEq(const Poly *p, const Poly *q);
  */
 Poly PolyAt(const Poly *p, poly_coeff_t x);
 
+/**
+ * Wylicza wartość wielomianu w punkcie @p x, tak jak PolyAt.
+ * Przejmuje na własność zawartość struktury wskazywanej przez @p p.
+ * Współczynniki, które nie wymagają mnożenia, trafiają do wyniku bez kopiowania.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] x : wartość argumentu @f$x@f$
+ * @return @f$p(x, x_0, x_1, \ldots)@f$
+ */
+Poly PolyAtOwn(Poly *p, poly_coeff_t x);
+
+/**
+ * Wylicza wartości wielomianu w wielu punktach naraz, tak jak PolyAt
+ * dla każdego z punktów. Jednomiany wielomianu są przechodzone raz dla
+ * całego bloku punktów.
+ * Wyniki trafiają do tablicy @p out, a wołający otrzymuje je na własność.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : liczba punktów
+ * @param[in] xs : tablica punktów
+ * @param[out] out : tablica wyników, @p out[k] to @f$p(xs_k, x_0, x_1, \ldots)@f$
+ */
+void PolyAtMany(const Poly *p, size_t n, const poly_coeff_t xs[], Poly out[]);
+
+/**
+ * Wylicza wartość liczbową wielomianu, podstawiając naraz wartości
+ * pod wszystkie zmienne. Zmienne o indeksach nie mniejszych niż @p nvars
+ * przyjmują wartość 0. Formalnie wynikiem jest
+ * @f$p(xs_0, xs_1, \ldots, xs_{nvars - 1}, 0, 0, \ldots)@f$.
+ * Nie przydziela pamięci na stercie.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] nvars : liczba wartości zmiennych
+ * @param[in] xs : wartości zmiennych
+ * @return wartość wielomianu
+ */
+poly_coeff_t PolyEval(const Poly *p, size_t nvars, const poly_coeff_t xs[]);
+
+/**
+ * Kompiluje wielomian do planu wyliczania wartości: drzewo jest spłaszczane
+ * do liniowego programu z wyliczonymi z góry krokami wykładników.
+ * Plan jest zapamiętywany przy wielomianie i jego kopiach, więc kolejne
+ * wywołania PolyEvalMany nie przechodzą drzewa. Plan jest usuwany razem
+ * z wielomianem albo przy jego modyfikacji. Jeśli plan już istnieje,
+ * funkcja nic nie robi.
+ * @param[in] p : wielomian @f$p@f$
+ */
+void PolyCompile(const Poly *p);
+
+/**
+ * Wylicza wartości liczbowe wielomianu w @p n punktach, tak jak PolyEval
+ * dla każdego punktu. Wartości zmiennych @p k-tego punktu to
+ * @p xs[k * nvars], ..., @p xs[k * nvars + nvars - 1].
+ * Korzysta z planu wielomianu, a jeśli go nie ma, najpierw go kompiluje.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : liczba punktów
+ * @param[in] nvars : liczba wartości zmiennych w punkcie
+ * @param[in] xs : wartości zmiennych kolejnych punktów
+ * @param[out] out : wartości wielomianu w kolejnych punktach
+ */
+void PolyEvalMany(const Poly *p, size_t n, size_t nvars, const poly_coeff_t xs[], poly_coeff_t out[]);
+
 /**
  * Wypisuje na standardowe wyjście jednomian.
  * @param[in] m : jednomian
@@ -269,4 +449,49 @@ void PolyPrint(const Poly *p);
  */
 Poly PolyCompose(const Poly *p, size_t count, const Poly q[]);
 
+/**
+ * Ustawia liczbę wątków, między które dzielone są duże operacje na
+ * wielomianach. Domyślnie operacje wykonują się w wątku wołającym.
+ * Wyniki operacji nie zależą od liczby wątków.
+ * @param[in] count : liczba wątków, co najmniej 1
+ */
+void PolySetThreads(size_t count);
+
+/**
+ * Włącza lub wyłącza mnożenie dużych wielomianów w postaci rozproszonej
+ * (zob. dist.h). Gdy jest włączone, PolyMul i PolyMulOwn zapisują czynniki
+ * mające razem co najmniej kilka tysięcy par wyrazów w postaci rozproszonej
+ * i scalają iloczyny wyrazów jednym kopcem po upakowanych wykładnikach
+ * wszystkich zmiennych. Czynniki, których nie da się tak zapisać, są mnożone
+ * zwykle. Domyślnie wyłączone.
+ * @param[in] enabled : Czy mnożyć w postaci rozproszonej?
+ */
+void PolySetDistMul(bool enabled);
+
+/**
+ * To jest struktura przechowująca liczniki pamięci podręcznej wyników.
+ */
+typedef struct PolyCacheStats {
+    size_t hits; ///< liczba wyników wziętych z pamięci podręcznej
+    size_t misses; ///< liczba wyników policzonych od nowa
+    size_t entries; ///< liczba zapamiętanych wyników
+    size_t bytes; ///< przybliżona pamięć zajmowana przez zapamiętane wyniki
+} PolyCacheStats;
+
+/**
+ * Ustawia limit pamięci podręcznej wyników PolyMul, PolyMulOwn
+ * i PolyCompose. Wyniki są zapamiętywane razem z argumentami i rozpoznawane
+ * po skrótach równych argumentów (zob. PolyHash). Po przekroczeniu limitu
+ * usuwane są najdawniej używane wyniki. Limit 0, domyślny, wyłącza pamięć
+ * podręczną i usuwa zapamiętane wyniki.
+ * @param[in] bytes : limit pamięci w bajtach
+ */
+void PolySetResultCache(size_t bytes);
+
+/**
+ * Daje liczniki pamięci podręcznej wyników.
+ * @return liczniki
+ */
+PolyCacheStats PolyResultCacheStats(void);
+
 #endif /* __POLY_H__ */
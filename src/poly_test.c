@@ -2,6 +2,8 @@
 #undef NDEBUG
 #endif
 
+#include "dist.h"
+#include "flat.h"
 #include "poly.h"
 #include <assert.h>
 #include <stdbool.h>
@@ -232,6 +234,491 @@ static bool SimpleMulTest(void) {
   return res;
 }
 
+static bool LongMulTest(void) {
+  /* (1 + x + ... + x^(n-1))^2 ma przy x^k współczynnik min(k + 1, 2n - 1 - k) */
+  const size_t n = 100;
+  Mono *arr = calloc(n, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t i = 0; i < n; ++i)
+    arr[i] = M(C(1), (poly_exp_t) i);
+  Poly a = PolyOwnMonos(n, arr);
+  arr = calloc(2 * n - 1, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t k = 0; k < 2 * n - 1; ++k) {
+    poly_coeff_t c = (poly_coeff_t) (k + 1 < 2 * n - 1 - k ? k + 1 : 2 * n - 1 - k);
+    arr[k] = M(C(c), (poly_exp_t) k);
+  }
+  Poly res = PolyOwnMonos(2 * n - 1, arr);
+  return TestMul(PolyClone(&a), a, res);
+}
+
+static Poly DensePoly(size_t n, const poly_coeff_t coeffs[], poly_exp_t low) {
+  Mono *arr = calloc(n, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t i = 0; i < n; ++i)
+    arr[i] = M(C(coeffs[i]), low + (poly_exp_t) i);
+  Poly res = PolyAddMonos(n, arr);
+  free(arr);
+  return res;
+}
+
+static bool TestNttMul(size_t n, poly_exp_t n_low, size_t m, poly_exp_t m_low,
+                       unsigned long seed) {
+  /* duże współczynniki i zera w środku: splot musi się przepełniać jak w PolyMul */
+  poly_coeff_t *a = calloc(n + m + n + m - 1, sizeof (poly_coeff_t));
+  CHECK_PTR(a);
+  poly_coeff_t *b = a + n;
+  poly_coeff_t *c = b + m;
+  for (size_t i = 0; i < n + m; ++i) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    a[i] = (seed % 7 == 0) ? 0 : (poly_coeff_t) seed;
+  }
+  for (size_t i = 0; i < n; ++i)
+    for (size_t j = 0; j < m; ++j)
+      c[i + j] = (poly_coeff_t) ((unsigned long) c[i + j] + (unsigned long) a[i] * (unsigned long) b[j]);
+  Poly p = DensePoly(n, a, n_low);
+  Poly q = DensePoly(m, b, m_low);
+  Poly res = DensePoly(n + m - 1, c, n_low + m_low);
+  free(a);
+  return TestMul(p, q, res);
+}
+
+static bool NttMulTest(void) {
+  bool res = true;
+  res &= TestNttMul(200, 0, 200, 0, 1);
+  res &= TestNttMul(300, 5, 120, 17, 2);
+  res &= TestNttMul(1000, 1, 700, 0, 3);
+  res &= TestNttMul(3000, 2, 2500, 9, 4);
+  return res;
+}
+
+static Poly DenseBivariate(size_t n, size_t k, poly_exp_t step, unsigned long seed) {
+  /* co piąty współczynnik jest zerem, pozostałe to wielomiany drugiej zmiennej */
+  Mono *arr = calloc(n, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t i = 0; i < n; ++i) {
+    Poly coeff = PolyZero();
+    for (size_t j = 0; j < k && i % 5 != 4; ++j) {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      Poly mono = P(C((poly_coeff_t) seed), (poly_exp_t) j * step);
+      coeff = PolyAddOwn(&coeff, &mono);
+    }
+    arr[i] = M(coeff, (poly_exp_t) i);
+  }
+  Poly res = PolyAddMonos(n, arr);
+  free(arr);
+  return res;
+}
+
+static bool TestDenseMul(size_t n, size_t m, size_t k, poly_exp_t step) {
+  Poly p = DenseBivariate(n, k, step, n);
+  Poly q = DenseBivariate(m, k, step, m + 1);
+  /* iloczyny przez pojedyncze jednomiany q liczymy zwykłym mnożeniem */
+  Poly res = PolyZero();
+  for (size_t j = 0; j < q.size; ++j) {
+    Poly mono = P(PolyClone(&q.arr[j].p), MonoGetExp(&q.arr[j]));
+    Poly mul = PolyMul(&p, &mono);
+    res = PolyAddOwn(&res, &mul);
+    PolyDestroy(&mono);
+  }
+  return TestMul(p, q, res);
+}
+
+static bool KaratsubaMulTest(void) {
+  /* rzadkie wykładniki drugiej zmiennej wykluczają podstawienie Kroneckera */
+  bool res = true;
+  res &= TestDenseMul(40, 40, 3, 1000);
+  res &= TestDenseMul(101, 45, 2, 1000);
+  res &= TestDenseMul(48, 90, 4, 1000);
+  return res;
+}
+
+static bool TestTrivariateMul(size_t n, size_t m) {
+  /* iloczyn wartości w punktach musi być wartością iloczynu */
+  Mono *arr = calloc(n + m, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t i = 0; i < n + m; ++i)
+    arr[i] = M(DenseBivariate(5, 3, 1, i), (poly_exp_t) (i < n ? i : i - n));
+  Poly p = PolyAddMonos(n, arr);
+  Poly q = PolyAddMonos(m, arr + n);
+  free(arr);
+  Poly r = PolyMul(&p, &q);
+  bool res = true;
+  for (poly_coeff_t k = 1; k <= 5; ++k) {
+    poly_coeff_t xs[3] = {k, 1000003 * k, -k * k * 7};
+    res &= PolyEval(&r, 3, xs) == PolyEval(&p, 3, xs) * PolyEval(&q, 3, xs);
+  }
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&r);
+  return res;
+}
+
+static bool KroneckerMulTest(void) {
+  bool res = true;
+  res &= TestDenseMul(12, 15, 3, 1);
+  res &= TestDenseMul(40, 33, 5, 2);
+  res &= TestDenseMul(300, 200, 4, 1);
+  /* iloczyn zeruje się przez przepełnienie */
+  poly_coeff_t big[8] = {1L << 32, 1L << 32, 1L << 32, 1L << 32, 1L << 32, 1L << 32, 1L << 32, 1L << 32};
+  res &= TestMul(DensePoly(8, big, 0), DensePoly(8, big, 3), C(0));
+  res &= TestTrivariateMul(6, 7);
+  return res;
+}
+
+static Poly SparseBivariate(size_t n, unsigned long seed) {
+  /* kwadratowe wykładniki wykluczają mnożenie w gęstej tablicy */
+  Mono *arr = calloc(n, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t i = 0; i < n; ++i) {
+    Poly coeff = PolyZero();
+    for (size_t j = 0; j < 3; ++j) {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      Poly mono = P(C((poly_coeff_t) seed), (poly_exp_t) j * 1000);
+      coeff = PolyAddOwn(&coeff, &mono);
+    }
+    arr[i] = M(coeff, (poly_exp_t) (i * i));
+  }
+  Poly res = PolyAddMonos(n, arr);
+  free(arr);
+  return res;
+}
+
+static bool TestThreadsMul(Poly p, Poly q) {
+  Poly serial = PolyMul(&p, &q);
+  PolySetThreads(4);
+  Poly parallel = PolyMul(&p, &q);
+  PolySetThreads(1);
+  bool res = PolyIsEq(&serial, &parallel);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&serial);
+  PolyDestroy(&parallel);
+  return res;
+}
+
+static bool ThreadsMulTest(void) {
+  /* wynik na kilku wątkach musi być taki sam jak na jednym */
+  bool res = true;
+  res &= TestThreadsMul(SparseBivariate(100, 1), SparseBivariate(120, 2));
+  res &= TestThreadsMul(SparseBivariate(90, 3), C(0));
+  res &= TestThreadsMul(DenseBivariate(300, 4, 1, 5), DenseBivariate(200, 4, 1, 6));
+  poly_coeff_t *coeffs = calloc(5000, sizeof (poly_coeff_t));
+  CHECK_PTR(coeffs);
+  for (size_t i = 0; i < 5000; ++i)
+    coeffs[i] = (poly_coeff_t) (i * i * 2654435761UL);
+  res &= TestThreadsMul(DensePoly(3000, coeffs, 2), DensePoly(2000, coeffs + 3000, 7));
+  free(coeffs);
+  return res;
+}
+
+static Poly WideTrivariate(size_t n, size_t step, unsigned long seed) {
+  /* n jednomianów, każdy ze współczynnikiem o 40 jednomianach drugiej zmiennej */
+  Mono *arr = calloc(n, sizeof (Mono));
+  CHECK_PTR(arr);
+  for (size_t i = 0; i < n; ++i)
+    arr[i] = M(DenseBivariate(40, 3, 1, seed + i), (poly_exp_t) (i * step));
+  Poly res = PolyAddMonos(n, arr);
+  free(arr);
+  return res;
+}
+
+static bool TasksTest(void) {
+  /* dodawanie, wartość w punkcie i usuwanie dzielone na zadania dają to samo co na jednym wątku */
+  Poly p = WideTrivariate(200, 1, 1);
+  Poly q = WideTrivariate(150, 2, 1000);
+  Poly neg = PolyNeg(&p);
+  Poly sum = PolyAdd(&p, &q);
+  Poly zero = PolyAdd(&p, &neg);
+  Poly at = PolyAt(&p, 3);
+  PolySetThreads(4);
+  Poly parallel_sum = PolyAdd(&p, &q);
+  Poly parallel_zero = PolyAdd(&p, &neg);
+  Poly parallel_at = PolyAt(&p, 3);
+  bool res = PolyIsEq(&sum, &parallel_sum) && PolyIsZero(&parallel_zero) && PolyIsEq(&at, &parallel_at);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&neg);
+  PolyDestroy(&parallel_sum);
+  PolyDestroy(&parallel_zero);
+  PolyDestroy(&parallel_at);
+  PolySetThreads(1);
+  PolyDestroy(&sum);
+  PolyDestroy(&zero);
+  PolyDestroy(&at);
+  return res;
+}
+
+static bool ThreadsComposeTest(void) {
+  /* złożenia jednomianów liczone jako zadania dają to samo co na jednym wątku */
+  Poly p = WideTrivariate(30, 3, 7);
+  Poly q[2] = {P(C(2), 0, C(-1), 1, C(1), 3), P(P(C(1), 1), 0, C(3), 2)};
+  Poly serial = PolyCompose(&p, 2, q);
+  PolySetThreads(4);
+  Poly parallel = PolyCompose(&p, 2, q);
+  Poly parallel_one = PolyCompose(&p, 1, q);
+  PolySetThreads(1);
+  Poly serial_one = PolyCompose(&p, 1, q);
+  bool res = PolyIsEq(&serial, &parallel) && PolyIsEq(&serial_one, &parallel_one);
+  PolyDestroy(&p);
+  PolyDestroy(&q[0]);
+  PolyDestroy(&q[1]);
+  PolyDestroy(&serial);
+  PolyDestroy(&parallel);
+  PolyDestroy(&serial_one);
+  PolyDestroy(&parallel_one);
+  return res;
+}
+
+static bool TestAddMany(size_t count, Poly ps[]) {
+  /* jedno scalenie daje to samo co kolejne dodawania, na jednym i na kilku wątkach */
+  Poly fold = PolyZero();
+  for (size_t i = 0; i < count; ++i) {
+    Poly copy = PolyClone(&ps[i]);
+    fold = PolyAddOwn(&fold, &copy);
+  }
+  Poly sum = PolyAddMany(count, ps);
+  PolySetThreads(4);
+  Poly parallel_sum = PolyAddMany(count, ps);
+  PolySetThreads(1);
+  bool res = PolyIsEq(&fold, &sum) && PolyIsEq(&fold, &parallel_sum);
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&ps[i]);
+  PolyDestroy(&fold);
+  PolyDestroy(&sum);
+  PolyDestroy(&parallel_sum);
+  return res;
+}
+
+static bool TestDegs(const Poly *p, poly_exp_t deg, poly_exp_t deg_0, poly_exp_t deg_1, poly_exp_t deg_2) {
+  /* stopnie są zapamiętywane, drugie pytanie musi dać te same wyniki */
+  bool res = true;
+  for (int i = 0; i < 2; ++i)
+    res &= PolyDeg(p) == deg && PolyDegBy(p, 0) == deg_0 && PolyDegBy(p, 1) == deg_1
+           && PolyDegBy(p, 2) == deg_2 && PolyDegBy(p, 3) == (deg < 0 ? -1 : 0);
+  return res;
+}
+
+static bool CachedDegTest(void) {
+  Poly a = P(P(C(1), 5), 0, P(C(2), 0, P(C(1), 7), 3), 2);
+  bool res = TestDegs(&a, 12, 2, 5, 7);
+  // Modyfikacja kopii nie zmienia stopni oryginału
+  Poly b = PolyClone(&a);
+  Poly c = P(P(C(1), 9), 4);
+  b = PolyAddOwn(&b, &c);
+  res &= TestDegs(&b, 13, 4, 9, 7);
+  res &= TestDegs(&a, 12, 2, 5, 7);
+  // Modyfikacja w miejscu usuwa zapamiętane stopnie
+  Poly d = P(P(C(3), 0, P(C(1), 11), 2), 6);
+  b = PolyAddOwn(&b, &d);
+  res &= TestDegs(&b, 19, 6, 9, 11);
+  Poly square = PolyMul(&a, &a);
+  res &= TestDegs(&square, 24, 4, 10, 14);
+  Poly neg = PolyNeg(&a);
+  Poly zero = PolyAdd(&a, &neg);
+  res &= TestDegs(&neg, 12, 2, 5, 7);
+  res &= TestDegs(&zero, -1, -1, -1, -1);
+  Poly at = PolyAt(&a, 1);
+  res &= TestDegs(&at, 10, 5, 7, 0);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&square);
+  PolyDestroy(&neg);
+  PolyDestroy(&zero);
+  PolyDestroy(&at);
+  return res;
+}
+
+static bool HashTest(void) {
+  bool res = true;
+  // Równe wielomiany zbudowane na różne sposoby mają równe skróty
+  Poly a = P(P(C(1), 0, C(2), 3), 1, C(5), 4);
+  Poly b = P(P(C(2), 3), 1, C(5), 4);
+  Poly c = P(P(C(1), 0), 1);
+  Poly sum = PolyAdd(&b, &c);
+  Poly mono = P(C(7), 2);
+  Poly mono_sum = PolyAdd(&mono, &a);
+  Poly mono_back = PolySub(&mono_sum, &a);
+  res &= PolyHash(&a) == PolyHash(&sum) && PolyIsEq(&a, &sum);
+  res &= PolyHash(&mono) == PolyHash(&mono_back) && PolyIsEq(&mono, &mono_back);
+  // Prawie równe duże wielomiany różnią się skrótami
+  Poly wide = WideTrivariate(100, 1, 1);
+  Poly other = WideTrivariate(100, 1, 1);
+  Poly one = P(P(P(C(1), 0), 0), 50);
+  Poly near = PolyAdd(&wide, &one);
+  res &= PolyHash(&wide) == PolyHash(&other) && PolyIsEq(&wide, &other);
+  res &= PolyHash(&wide) != PolyHash(&near) && !PolyIsEq(&wide, &near);
+  Poly one_coeff = C(1);
+  Poly two_coeff = C(2);
+  res &= PolyHash(&a) != PolyHash(&b) && PolyHash(&one_coeff) != PolyHash(&two_coeff);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&c);
+  PolyDestroy(&sum);
+  PolyDestroy(&mono);
+  PolyDestroy(&mono_sum);
+  PolyDestroy(&mono_back);
+  PolyDestroy(&wide);
+  PolyDestroy(&other);
+  PolyDestroy(&one);
+  PolyDestroy(&near);
+  return res;
+}
+
+static bool HashConsTest(void) {
+  bool res = true;
+  PolySetHashConsing(true);
+  // Równe drzewa zbudowane osobno po wspólnym zapisie mają te same węzły
+  Poly inner = P(C(1), 0, C(2), 3);
+  Poly a = P(P(C(1), 0, C(2), 3), 1, C(5), 4);
+  Poly b = P(P(C(1), 0, C(2), 3), 1, C(5), 4);
+  Poly c = P(P(C(1), 0, C(2), 3), 2, P(C(1), 0, C(2), 3), 5);
+  a = PolyIntern(&a);
+  b = PolyIntern(&b);
+  c = PolyIntern(&c);
+  res &= a.arr == b.arr && PolyIsEq(&a, &b);
+  res &= a.arr[0].p.arr == c.arr[0].p.arr && c.arr[0].p.arr == c.arr[1].p.arr;
+  res &= !PolyIsEq(&a, &c);
+  // Współdzielone poddrzewo zostaje bez zmian zamiast być kopiowane
+  Poly wrapped = P(PolyClone(&inner), 7);
+  wrapped = PolyIntern(&wrapped);
+  res &= wrapped.arr[0].p.arr == inner.arr && PolyIsEq(&wrapped.arr[0].p, &c.arr[0].p);
+  // Modyfikacja wspólnego wielomianu nie zmienia pozostałych
+  Poly one = P(C(1), 1);
+  a = PolyAddOwn(&a, &one);
+  Poly expected = P(P(C(1), 0, C(2), 3), 1, C(5), 4);
+  res &= a.arr != b.arr && !PolyIsEq(&a, &b) && PolyIsEq(&b, &expected);
+  res &= PolyIsEq(&c.arr[0].p, &inner);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&c);
+  PolyDestroy(&wrapped);
+  PolyDestroy(&inner);
+  PolyDestroy(&expected);
+  PolySetHashConsing(false);
+  // Poza trybem węzłów wspólnych PolyIntern nie zmienia wielomianu
+  Poly d = P(C(3), 1);
+  Mono *arr = d.arr;
+  d = PolyIntern(&d);
+  res &= d.arr == arr;
+  PolyDestroy(&d);
+  return res;
+}
+
+static bool ResultCacheTest(void) {
+  bool res = true;
+  PolySetResultCache(1 << 20);
+  PolyCacheStats before = PolyResultCacheStats();
+  // Równe argumenty zbudowane osobno trafiają w zapamiętany iloczyn
+  Poly a = WideTrivariate(20, 1, 1);
+  Poly b = P(P(C(1), 0, C(2), 1), 0, C(3), 2);
+  Poly a2 = WideTrivariate(20, 1, 1);
+  Poly b2 = P(P(C(1), 0, C(2), 1), 0, C(3), 2);
+  Poly first = PolyMul(&a, &b);
+  Poly second = PolyMul(&b2, &a2);
+  PolyCacheStats after = PolyResultCacheStats();
+  res &= after.misses == before.misses + 1 && after.hits == before.hits + 1;
+  res &= second.arr == first.arr && after.entries == before.entries + 1;
+  // Modyfikacja wyniku nie zmienia zapamiętanej wartości
+  Poly one = C(1);
+  second = PolyAddOwn(&second, &one);
+  Poly third = PolyMul(&a, &b);
+  res &= PolyIsEq(&third, &first) && !PolyIsEq(&second, &first);
+  // Złożenie też jest zapamiętywane
+  Poly q[] = {P(C(1), 1), C(2)};
+  Poly composed = PolyCompose(&b, 2, q);
+  Poly composed2 = PolyCompose(&b2, 2, q);
+  Poly other = PolyCompose(&b, 1, q);
+  res &= composed.arr == composed2.arr && !PolyIsEq(&composed, &other);
+  // Mały limit usuwa najdawniej używane wyniki
+  PolyCacheStats full = PolyResultCacheStats();
+  PolySetResultCache(full.bytes - 1);
+  PolyCacheStats trimmed = PolyResultCacheStats();
+  res &= trimmed.entries < full.entries && trimmed.bytes < full.bytes;
+  PolySetResultCache(0);
+  res &= PolyResultCacheStats().entries == 0;
+  Poly fourth = PolyMul(&a, &b);
+  res &= PolyIsEq(&fourth, &first) && PolyResultCacheStats().hits == full.hits;
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&a2);
+  PolyDestroy(&b2);
+  PolyDestroy(&first);
+  PolyDestroy(&second);
+  PolyDestroy(&third);
+  PolyDestroy(&fourth);
+  PolyDestroy(&q[0]);
+  PolyDestroy(&composed);
+  PolyDestroy(&composed2);
+  PolyDestroy(&other);
+  return res;
+}
+
+static bool TestSortMonos(size_t n, const poly_exp_t exps[]) {
+  /* PolyAddMonos sortuje jednomiany, PolyAddMany scala je kopcem */
+  Mono *arr = calloc(n, sizeof (Mono));
+  Poly *ps = calloc(n, sizeof (Poly));
+  CHECK_PTR(arr);
+  CHECK_PTR(ps);
+  for (size_t i = 0; i < n; ++i) {
+    poly_coeff_t c = (poly_coeff_t) (i % 7) - 3;
+    arr[i] = M(i % 5 == 0 ? P(C(c), 1) : C(c), exps[i]);
+    ps[i] = P(i % 5 == 0 ? P(C(c), 1) : C(c), exps[i]);
+  }
+  Poly sorted = PolyAddMonos(n, arr);
+  Poly merged = PolyAddMany(n, ps);
+  bool res = PolyIsEq(&sorted, &merged);
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(&ps[i]);
+  PolyDestroy(&sorted);
+  PolyDestroy(&merged);
+  free(arr);
+  free(ps);
+  return res;
+}
+
+static bool SortMonosTest(void) {
+  const size_t n = 3000;
+  poly_exp_t *exps = calloc(n, sizeof (poly_exp_t));
+  CHECK_PTR(exps);
+  bool res = true;
+  // Tablica posortowana i odwrócona
+  for (size_t i = 0; i < n; ++i)
+    exps[i] = (poly_exp_t) (i / 2);
+  res &= TestSortMonos(n, exps);
+  for (size_t i = 0; i < n; ++i)
+    exps[i] = (poly_exp_t) (n - i);
+  res &= TestSortMonos(n, exps);
+  // Kilka posortowanych serii
+  for (size_t i = 0; i < n; ++i)
+    exps[i] = (poly_exp_t) ((i % 500) * 3 + i / 500);
+  res &= TestSortMonos(n, exps);
+  // Losowe wykładniki, małe i duże
+  unsigned long seed = 12345;
+  for (size_t i = 0; i < n; ++i) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    exps[i] = (poly_exp_t) ((seed >> 33) % (i % 2 == 0 ? 400 : 1u << 30));
+  }
+  res &= TestSortMonos(n, exps);
+  res &= TestSortMonos(20, exps);
+  free(exps);
+  return res;
+}
+
+static bool AddManyTest(void) {
+  bool res = TestAddMany(0, NULL);
+  res &= TestAddMany(3, (Poly[]) {C(1), C(-4), C(3)});
+  res &= TestAddMany(4, (Poly[]) {P(C(1), 2), C(5), P(P(C(2), 1), 2), P(C(-1), 2, C(1), 3)});
+  res &= TestAddMany(3, (Poly[]) {P(P(C(1), 0, C(2), 1), 1), P(C(7), 0, P(C(-2), 1), 1), P(P(C(-1), 0), 1)});
+  Poly *ps = calloc(64, sizeof (Poly));
+  CHECK_PTR(ps);
+  for (size_t i = 0; i < 64; ++i)
+    ps[i] = WideTrivariate(20 + i, 1 + i % 3, i);
+  res &= TestAddMany(64, ps);
+  free(ps);
+  return res;
+}
+
 static bool SimpleNegTest(void) {
   Poly a = P(P(C(1), 0, C(2), 2), 0, P(C(1), 1), 1, C(1), 2);
   Poly b = PolyNeg(&a);
@@ -297,6 +784,380 @@ static bool SimpleAtTest(void) {
   res &= TestAt(P(C(3), 1, C(2), 3, C(1), 5), 10, C(102030));
   res &= TestAt(P(P(C(1), 4), 0, P(C(1), 2), 2, C(1), 3), 2,
                 P(C(8), 0, C(4), 2, C(1), 4));
+  res &= TestAt(P(C(5), 0, P(C(1), 0, C(2), 1), 1, P(C(3), 1), 2), 1,
+                P(C(6), 0, C(5), 1));
+  res &= TestAt(P(C(5), 0, P(C(1), 0, C(2), 1), 1, P(C(3), 1), 2), 0, C(5));
+  res &= TestAt(P(P(C(2), 1), 1, P(C(-1), 1), 2), 2, C(0));
+  return res;
+}
+
+static bool TestOwnOps(Poly a, Poly b) {
+  bool res = true;
+  Poly (*ops[])(const Poly *, const Poly *) = {PolyAdd, PolySub, PolyMul};
+  Poly (*own_ops[])(Poly *, Poly *) = {PolyAddOwn, PolySubOwn, PolyMulOwn};
+  for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+    Poly expected = ops[i](&a, &b);
+    Poly a_copy = PolyClone(&a);
+    Poly b_copy = PolyClone(&b);
+    Poly c = own_ops[i](&a_copy, &b_copy);
+    res &= PolyIsEq(&c, &expected);
+    PolyDestroy(&c);
+    PolyDestroy(&expected);
+  }
+  Poly expected = PolyNeg(&a);
+  Poly a_copy = PolyClone(&a);
+  Poly c = PolyNegOwn(&a_copy);
+  res &= PolyIsEq(&c, &expected);
+  PolyDestroy(&c);
+  PolyDestroy(&expected);
+  expected = PolyAt(&a, 3);
+  a_copy = PolyClone(&a);
+  c = PolyAtOwn(&a_copy, 3);
+  res &= PolyIsEq(&c, &expected);
+  PolyDestroy(&c);
+  PolyDestroy(&expected);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  return res;
+}
+
+static bool OwnOpsTest(void) {
+  bool res = true;
+  res &= TestOwnOps(C(1), C(2));
+  res &= TestOwnOps(P(C(1), 1), C(-1));
+  res &= TestOwnOps(C(1), P(C(-1), 0, C(1), 1));
+  res &= TestOwnOps(P(C(1), 1, C(2), 2), P(C(-1), 1));
+  res &= TestOwnOps(P(P(C(1), 0, C(1), 1), 0, C(1), 1),
+                    P(P(C(1), 0, C(-1), 1), 0, C(-1), 1));
+  res &= TestOwnOps(POLY_P, POLY_P);
+  res &= TestOwnOps(P(C(1L << 32), 1, P(C(1), 2), 3), C(1L << 32));
+  return res;
+}
+
+static bool SharedCloneTest(void) {
+  bool res = true;
+  Poly a = POLY_P;
+  Poly b = PolyClone(&a);
+  Poly c = PolyClone(&a);
+  /* modyfikacja kopii nie może zmienić oryginału */
+  Poly neg = PolyNegOwn(&b);
+  Poly one = C(1);
+  Poly sum = PolyAddOwn(&c, &one);
+  Poly expected = POLY_P;
+  res &= PolyIsEq(&a, &expected);
+  res &= !PolyIsEq(&neg, &a);
+  res &= !PolyIsEq(&sum, &a);
+  PolyDestroy(&a);
+  res &= TestAdd(neg, PolyClone(&expected), C(0));
+  res &= TestSub(sum, expected, C(1));
+  return res;
+}
+
+static bool TestCompose(Poly p, size_t count, Poly q[], Poly res) {
+  Poly c = PolyCompose(&p, count, q);
+  bool is_eq = PolyIsEq(&c, &res);
+  PolyDestroy(&p);
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&q[i]);
+  PolyDestroy(&c);
+  PolyDestroy(&res);
+  return is_eq;
+}
+
+static bool SimpleComposeTest(void) {
+  bool res = true;
+  {
+    Poly q[] = {P(C(1), 0, C(1), 1)};
+    res &= TestCompose(P(C(1), 2, C(1), 4), 1, q,
+                       P(C(2), 0, C(6), 1, C(7), 2, C(4), 3, C(1), 4));
+  }
+  {
+    Poly q[] = {P(C(1), 0, C(1), 1), C(2)};
+    res &= TestCompose(P(P(C(1), 1), 2), 2, q,
+                       P(C(2), 0, C(4), 1, C(2), 2));
+  }
+  {
+    Poly q[] = {P(C(1), 1)};
+    res &= TestCompose(P(C(1), 1, C(1), 2, C(1), 3, C(1), 5, C(1), 8), 1, q,
+                       P(C(1), 1, C(1), 2, C(1), 3, C(1), 5, C(1), 8));
+  }
+  res &= TestCompose(P(P(C(3), 0, C(1), 1), 0, C(1), 1), 0, NULL, C(3));
+  return res;
+}
+
+static bool TestAtMany(Poly p, size_t n, const poly_coeff_t xs[]) {
+  bool res = true;
+  Poly *at = malloc(sizeof(Poly) * n);
+  assert(at != NULL);
+  PolyAtMany(&p, n, xs, at);
+  for (size_t i = 0; i < n; ++i) {
+    Poly expected = PolyAt(&p, xs[i]);
+    res &= PolyIsEq(&at[i], &expected);
+    PolyDestroy(&expected);
+    PolyDestroy(&at[i]);
+  }
+  free(at);
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool AtManyTest(void) {
+  bool res = true;
+  poly_coeff_t xs[100];
+  for (size_t i = 0; i < 100; ++i)
+    xs[i] = (poly_coeff_t) i - 50;
+  res &= TestAtMany(C(7), 3, xs);
+  res &= TestAtMany(P(C(3), 1, C(2), 3, C(1), 5), 100, xs);
+  res &= TestAtMany(P(C(1), 0, C(1), 64), 100, xs);
+  res &= TestAtMany(P(P(C(1), 4), 0, P(C(1), 2), 2, C(1), 3), 100, xs);
+  res &= TestAtMany(P(P(C(2), 1), 1, P(C(-1), 1, C(3), 2), 2), 65, xs + 10);
+  res &= TestAtMany(P(C(1), 1), 0, xs);
+  return res;
+}
+
+static bool TestEval(Poly p, size_t nvars, const poly_coeff_t xs[], poly_coeff_t res) {
+  bool is_eq = PolyEval(&p, nvars, xs) == res;
+  PolyDestroy(&p);
+  return is_eq;
+}
+
+static bool SimpleEvalTest(void) {
+  bool res = true;
+  poly_coeff_t xs[] = {2, 3, -1};
+  res &= TestEval(C(5), 0, NULL, 5);
+  res &= TestEval(P(C(3), 1, C(2), 3, C(1), 5), 1, xs, 3 * 2 + 2 * 8 + 32);
+  res &= TestEval(P(P(C(1), 4), 0, P(C(1), 2), 2, C(1), 3), 2, xs, 81 + 4 * 9 + 8);
+  res &= TestEval(P(P(C(1), 0, P(C(7), 2), 1), 1), 3, xs, 2 * (1 + 3 * 7));
+  res &= TestEval(P(C(4), 0, P(C(1), 1), 1, C(3), 2), 1, xs, 4 + 12);
+  res &= TestEval(P(C(4), 0, P(C(1), 1), 1, C(3), 2), 0, NULL, 4);
+  res &= TestEval(P(C(1), 1), 0, NULL, 0);
+  res &= TestEval(P(C(1), 64), 1, xs, 0);
+  {
+    poly_coeff_t many[40];
+    for (size_t i = 0; i < 40; ++i)
+      many[i] = 1;
+    many[39] = 2;
+    Poly p = P(C(1), 3);
+    for (size_t i = 0; i < 39; ++i)
+      p = P(p, 1);
+    res &= TestEval(p, 40, many, 8);
+  }
+  return res;
+}
+
+static bool TestEvalMany(Poly p, size_t nvars) {
+  bool res = true;
+  size_t n = 100;
+  poly_coeff_t *xs = malloc(sizeof(poly_coeff_t) * n * nvars);
+  poly_coeff_t *out = malloc(sizeof(poly_coeff_t) * n);
+  assert(xs != NULL && out != NULL);
+  for (size_t i = 0; i < n * nvars; ++i)
+    xs[i] = (poly_coeff_t) (i * 7 % 11) - 5;
+  PolyEvalMany(&p, n, nvars, xs, out);
+  for (size_t k = 0; k < n; ++k)
+    res &= out[k] == PolyEval(&p, nvars, xs + k * nvars);
+  /* drugi raz z zapamiętanego planu*/
+  Poly q = PolyClone(&p);
+  PolyEvalMany(&q, n, nvars, xs, out);
+  for (size_t k = 0; k < n; ++k)
+    res &= out[k] == PolyEval(&p, nvars, xs + k * nvars);
+  /* modyfikacja usuwa plan*/
+  Poly one = C(1);
+  q = PolyAddOwn(&q, &one);
+  PolyEvalMany(&q, n, nvars, xs, out);
+  for (size_t k = 0; k < n; ++k)
+    res &= out[k] == PolyEval(&p, nvars, xs + k * nvars) + 1;
+  PolyDestroy(&q);
+  PolyDestroy(&p);
+  free(xs);
+  free(out);
+  return res;
+}
+
+static bool EvalManyTest(void) {
+  bool res = true;
+  res &= TestEvalMany(C(5), 2);
+  res &= TestEvalMany(P(C(3), 1, C(2), 3, C(1), 5), 1);
+  res &= TestEvalMany(P(C(1), 0, C(1), 64), 1);
+  res &= TestEvalMany(P(P(C(1), 4), 0, P(C(1), 2), 2, C(1), 3), 2);
+  res &= TestEvalMany(P(P(C(1), 0, P(C(7), 2), 1), 1, C(-3), 2), 3);
+  res &= TestEvalMany(P(P(C(1), 0, P(C(7), 2), 1), 1, C(-3), 2), 1);
+  res &= TestEvalMany(P(P(C(2), 1, P(C(1), 1), 3), 2, P(C(4), 5), 6), 0);
+  return res;
+}
+
+static bool TestFlat(Poly p) {
+  bool res = true;
+  FlatPoly f = FlatFromPoly(&p);
+  Poly back = FlatToPoly(&f);
+  res &= PolyIsEq(&p, &back);
+  res &= FlatDeg(&f) == PolyDeg(&p);
+  for (size_t var_idx = 0; var_idx < 4; ++var_idx)
+    res &= FlatDegBy(&f, var_idx) == PolyDegBy(&p, var_idx);
+  poly_coeff_t xs[] = {2, -3, 5};
+  for (size_t nvars = 0; nvars <= 3; ++nvars)
+    res &= FlatEval(&f, nvars, xs) == PolyEval(&p, nvars, xs);
+  FlatPoly g = FlatFromPoly(&back);
+  res &= FlatIsEq(&f, &g);
+  Poly one = C(1);
+  Poly q = PolyAdd(&p, &one);
+  FlatPoly h = FlatFromPoly(&q);
+  res &= !FlatIsEq(&f, &h);
+  FlatDestroy(&f);
+  FlatDestroy(&g);
+  FlatDestroy(&h);
+  PolyDestroy(&p);
+  PolyDestroy(&back);
+  PolyDestroy(&q);
+  return res;
+}
+
+static bool FlatTest(void) {
+  bool res = true;
+  res &= TestFlat(C(0));
+  res &= TestFlat(C(-7));
+  res &= TestFlat(P(C(3), 1, C(2), 3, C(1), 5));
+  res &= TestFlat(P(P(C(1), 4), 0, P(C(1), 2), 2, C(1), 3));
+  res &= TestFlat(P(P(C(1), 0, P(C(7), 2), 1), 1, C(-3), 2));
+  res &= TestFlat(P(C(5), 0, P(P(C(1), 3), 1, C(4), 2), 4, P(C(2), 6), 7));
+  return res;
+}
+
+static bool TestDist(Poly p, Poly q, size_t nvars) {
+  bool res = DistFits(&p, nvars) && DistFits(&q, nvars);
+  DistPoly a = DistFromPoly(&p, nvars);
+  DistPoly b = DistFromPoly(&q, nvars);
+  Poly back = DistToPoly(&a);
+  res &= PolyIsEq(&p, &back);
+  PolyDestroy(&back);
+
+  Poly sum = PolyAdd(&p, &q);
+  DistPoly dist_sum = DistAdd(&a, &b);
+  back = DistToPoly(&dist_sum);
+  res &= PolyIsEq(&sum, &back);
+  PolyDestroy(&back);
+
+  Poly mul = PolyMul(&p, &q);
+  res &= DistMulFits(&a, &b);
+  DistPoly dist_mul = DistMul(&a, &b);
+  back = DistToPoly(&dist_mul);
+  res &= PolyIsEq(&mul, &back);
+  PolyDestroy(&back);
+  DistPoly mul_again = DistFromPoly(&mul, nvars);
+  res &= DistIsEq(&dist_mul, &mul_again);
+  back = DistMulPoly(&p, &q);
+  res &= PolyIsEq(&mul, &back);
+  PolyDestroy(&back);
+
+  poly_coeff_t xs[DIST_MAX_VARS];
+  for (size_t v = 0; v < nvars; ++v)
+    xs[v] = (poly_coeff_t) (v * 3 % 5) - 2;
+  res &= DistEval(&dist_mul, xs) == PolyEval(&mul, nvars, xs);
+  res &= DistEval(&dist_sum, xs) == PolyEval(&sum, nvars, xs);
+
+  DistDestroy(&a);
+  DistDestroy(&b);
+  DistDestroy(&dist_sum);
+  DistDestroy(&dist_mul);
+  DistDestroy(&mul_again);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&sum);
+  PolyDestroy(&mul);
+  return res;
+}
+
+static bool DistTest(void) {
+  bool res = true;
+  res &= TestDist(C(0), C(5), 1);
+  res &= TestDist(P(C(3), 1, C(2), 3, C(1), 5), P(C(-3), 1, C(1), 2), 1);
+  res &= TestDist(P(P(C(1), 4), 0, P(C(1), 2), 2, C(1), 3),
+                  P(P(C(-1), 4), 0, P(C(1), 0, C(2), 1), 2), 2);
+  res &= TestDist(P(P(C(1), 0, P(C(7), 2), 1), 1, C(-3), 2),
+                  P(P(P(C(1), 1), 0, C(1L << 40), 3), 2), 5);
+  res &= TestDist(P(P(C(1), 1000000), 0, C(2), 2000000000),
+                  P(P(C(3), 2000), 1), 2);
+  /* 32 zmienne mają pola po 2 bity, więc tylko wykładniki 0 i 1 */
+  Poly p = P(P(C(1), 1), 1);
+  res &= DistFits(&p, 32);
+  res &= !DistFits(&p, 1);
+  PolyDestroy(&p);
+  /* 16 zmiennych ma pola po 4 bity, wykładniki do 7, a suma 5 + 5 nie mieści się */
+  p = P(C(1), 5);
+  res &= !DistFits(&p, 32);
+  DistPoly d = DistFromPoly(&p, 16);
+  res &= !DistMulFits(&d, &d);
+  DistDestroy(&d);
+  PolyDestroy(&p);
+  /* duże iloczyny liczone przez PolyMul w postaci rozproszonej */
+  Poly wide = WideTrivariate(20, 5, 1);
+  Poly other = WideTrivariate(20, 3, 2);
+  Poly expected = PolyMul(&wide, &other);
+  PolySetDistMul(true);
+  Poly product = PolyMul(&wide, &other);
+  res &= PolyIsEq(&product, &expected);
+  PolyDestroy(&product);
+  product = PolyMulOwn(&wide, &other);
+  res &= PolyIsEq(&product, &expected);
+  PolySetDistMul(false);
+  PolyDestroy(&product);
+  PolyDestroy(&expected);
+  return res;
+}
+
+static bool InlineMonoTest(void) {
+  bool res = true;
+  Poly a = P(C(3), 2);
+  Poly b = P(C(-3), 2);
+  Poly c = P(C(2), 5);
+  res &= PolyIsInline(&a) && PolyInlineExp(&a) == 2 && a.coeff == 3;
+  res &= !PolyIsCoeff(&a) && !PolyIsZero(&a);
+  Poly sum = PolyAdd(&a, &b);
+  res &= PolyIsZero(&sum);
+  Poly mul = PolyMul(&a, &c);
+  res &= PolyIsInline(&mul) && PolyInlineExp(&mul) == 7 && mul.coeff == 6;
+  Poly at = PolyAt(&mul, 2);
+  res &= PolyIsCoeff(&at) && at.coeff == 6 * 128;
+  Poly clone = PolyClone(&a);
+  res &= PolyIsEq(&clone, &a) && !PolyIsEq(&a, &b) && !PolyIsEq(&a, &c);
+  res &= PolyDeg(&a) == 2 && PolyDegBy(&a, 0) == 2 && PolyDegBy(&a, 1) == 0;
+  Poly nested = P(P(C(1), 1), 1);
+  res &= !PolyIsInline(&nested) && PolyIsInline(&nested.arr[0].p);
+  Poly free_term = P(C(1), 0, C(2), 5);
+  Poly minus_one = C(-1);
+  Poly add_coeff = PolyAdd(&free_term, &minus_one);
+  res &= PolyIsInline(&add_coeff) && PolyInlineExp(&add_coeff) == 5 && add_coeff.coeff == 2;
+  Poly one = C(1);
+  Poly sub_coeff = PolySub(&free_term, &one);
+  res &= PolyIsInline(&sub_coeff) && PolyIsEq(&sub_coeff, &add_coeff);
+  Poly add_coeff_first = PolyAdd(&minus_one, &free_term);
+  res &= PolyIsInline(&add_coeff_first) && PolyIsEq(&add_coeff_first, &add_coeff);
+  PolyDestroy(&sum);
+  PolyDestroy(&mul);
+  PolyDestroy(&at);
+  PolyDestroy(&clone);
+  PolyDestroy(&nested);
+  PolyDestroy(&free_term);
+  PolyDestroy(&add_coeff);
+  PolyDestroy(&sub_coeff);
+  PolyDestroy(&add_coeff_first);
+  res &= TestAdd(PolyClone(&a), PolyClone(&c), P(C(3), 2, C(2), 5));
+  res &= TestAdd(PolyClone(&a), C(1), P(C(1), 0, C(3), 2));
+  res &= TestMul(PolyClone(&a), P(C(1), 0, C(1), 1), P(C(3), 2, C(3), 3));
+  res &= TestOwnOps(PolyClone(&a), PolyClone(&c));
+  res &= TestOwnOps(PolyClone(&a), PolyClone(&b));
+  res &= TestOwnOps(P(P(C(1), 1), 0, C(4), 3), PolyClone(&a));
+  res &= TestAt(P(P(C(2), 3), 1, P(C(-1), 3), 2), 1, P(C(1), 3));
+  res &= TestFlat(PolyClone(&c));
+  res &= TestFlat(P(P(C(2), 3), 1, P(C(-1), 1, C(5), 2), 2));
+  res &= TestEvalMany(P(P(C(2), 3), 1, C(7), 2), 2);
+  {
+    Poly q[] = {P(C(1), 0, C(1), 1)};
+    res &= TestCompose(PolyClone(&a), 1, q, P(C(3), 0, C(6), 1, C(3), 2));
+  }
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&c);
   return res;
 }
 
@@ -313,12 +1174,34 @@ int main() {
   assert(SimpleAddTest());
   assert(SimpleAddMonosTest());
   assert(SimpleMulTest());
+  assert(LongMulTest());
+  assert(NttMulTest());
+  assert(KaratsubaMulTest());
+  assert(KroneckerMulTest());
+  assert(ThreadsMulTest());
+  assert(TasksTest());
+  assert(ThreadsComposeTest());
+  assert(AddManyTest());
+  assert(SortMonosTest());
+  assert(CachedDegTest());
+  assert(HashTest());
+  assert(HashConsTest());
+  assert(ResultCacheTest());
   assert(SimpleNegTest());
   assert(SimpleSubTest());
   assert(SimpleDegByTest());
   assert(SimpleDegTest());
   assert(SimpleIsEqTest());
   assert(SimpleAtTest());
+  assert(SimpleComposeTest());
+  assert(AtManyTest());
+  assert(SimpleEvalTest());
+  assert(EvalManyTest());
+  assert(FlatTest());
+  assert(DistTest());
+  assert(InlineMonoTest());
+  assert(OwnOpsTest());
+  assert(SharedCloneTest());
   assert(OverflowTest());
   return 0;
 }
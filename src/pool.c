@@ -0,0 +1,253 @@
+/** @file
+  Implementacja puli pamięci
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "pool.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Kod zakończenia.
+ * Jeśli wystąpi błąd krytyczny, np. zabraknie pamięci, program powinien zakończyć się awaryjnie kodem 1.
+*/
+#define ERROR_EXIT_STATUS 1
+
+#ifdef POLY_POOL_ALLOCATOR
+
+/** Rozmiar najmniejszej klasy (razem z nagłówkiem bloku) */
+#define POOL_MIN_CLASS_SIZE 32
+/**
+ * Liczba klas rozmiarów. Klasy mają na przemian rozmiary @f$2^k@f$
+ * i @f$1.5 \cdot 2^k@f$, od 32 B do 64 KiB.
+ */
+#define POOL_CLASSES 23
+/** Klasa bloków przydzielanych bezpośrednio przez malloc */
+#define POOL_LARGE POOL_CLASSES
+/** Rozmiar kawałka pamięci, z którego wycinane są nowe bloki */
+#define POOL_CHUNK_SIZE (256 * 1024)
+
+/**
+ * Nagłówek bloku. Poprzedza pamięć zwracaną użytkownikowi,
+ * wyrównanie zapewnia, że pamięć za nagłówkiem jest wyrównana
+ * tak samo jak pamięć z malloc.
+ */
+typedef union PoolHeader {
+    size_t size_class; ///< klasa rozmiaru bloku
+    max_align_t align; ///< wyrównanie
+} PoolHeader;
+
+/**
+ * Wolny blok na liście wolnych bloków swojej klasy.
+ */
+typedef struct PoolFreeBlock {
+    struct PoolFreeBlock *next; ///< następny wolny blok tej klasy
+} PoolFreeBlock;
+
+/**
+ * Kawałek pamięci, z którego wycinane są bloki. Kawałki tworzą listę,
+ * dzięki czemu cała przydzielona pamięć pozostaje osiągalna.
+ */
+typedef union PoolChunk {
+    union PoolChunk *previous; ///< poprzednio przydzielony kawałek
+    max_align_t align; ///< wyrównanie
+} PoolChunk;
+
+/** Listy wolnych bloków bieżącego wątku, osobno dla każdej klasy */
+static _Thread_local PoolFreeBlock *free_lists[POOL_CLASSES];
+/** Ostatnio przydzielony kawałek pamięci bieżącego wątku */
+static _Thread_local PoolChunk *current_chunk = NULL;
+/** Początek niewykorzystanej części bieżącego kawałka */
+static _Thread_local char *chunk_begin = NULL;
+/** Koniec bieżącego kawałka */
+static _Thread_local char *chunk_end = NULL;
+
+/**
+ * Wolne bloki oddane przez inne wątki, osobno dla każdej klasy.
+ * Listy są tylko w całości doklejane i w całości zabierane,
+ * więc wystarczają operacje atomowe bez blokady.
+ */
+static PoolFreeBlock *_Atomic orphan_lists[POOL_CLASSES];
+
+/**
+ * Zwraca rozmiar bloku (razem z nagłówkiem) danej klasy.
+ * @param[in] size_class : klasa rozmiaru
+ * @return rozmiar bloku w bajtach
+ */
+static size_t ClassSize(size_t size_class) {
+    size_t base = (size_t) POOL_MIN_CLASS_SIZE << (size_class / 2);
+    return (size_class % 2 == 0) ? base : base + base / 2;
+}
+
+/**
+ * Wyznacza najmniejszą klasę, której bloki mieszczą @p bytes bajtów
+ * (razem z nagłówkiem).
+ * @param[in] bytes : rozmiar bloku w bajtach
+ * @return klasa rozmiaru lub POOL_LARGE, jeśli blok jest za duży
+ */
+static size_t SizeClass(size_t bytes) {
+    if (bytes <= POOL_MIN_CLASS_SIZE) {
+        return 0;
+    }
+    /* log to najwyższy ustawiony bit liczby bytes - 1 */
+    size_t rest = (bytes - 1) / POOL_MIN_CLASS_SIZE;
+    size_t log = 0;
+    while (rest > 1) {
+        rest >>= 1;
+        log++;
+    }
+    size_t base = (size_t) POOL_MIN_CLASS_SIZE << log;
+    size_t size_class = (bytes <= base + base / 2) ? 2 * log + 1 : 2 * log + 2;
+    return (size_class < POOL_CLASSES) ? size_class : POOL_LARGE;
+}
+
+/**
+ * Wycina nowy blok danej klasy z bieżącego kawałka pamięci.
+ * Jeśli w kawałku brakuje miejsca, przydziela nowy kawałek.
+ * @param[in] size_class : klasa rozmiaru
+ * @return nowy blok
+ */
+static PoolHeader *PoolCarve(size_t size_class) {
+    size_t size = ClassSize(size_class);
+    if (chunk_begin == NULL || (size_t) (chunk_end - chunk_begin) < size) {
+        PoolChunk *chunk = malloc(POOL_CHUNK_SIZE);
+        if (chunk == NULL) {
+            exit(ERROR_EXIT_STATUS);
+        }
+        chunk->previous = current_chunk;
+        current_chunk = chunk;
+        chunk_begin = (char *) (chunk + 1);
+        chunk_end = (char *) chunk + POOL_CHUNK_SIZE;
+    }
+    PoolHeader *header = (PoolHeader *) chunk_begin;
+    chunk_begin += size;
+    return header;
+}
+
+/**
+ * Przejmuje wolne bloki danej klasy oddane przez inne wątki.
+ * @param[in] size_class : klasa rozmiaru
+ * @return Czy lista wolnych bloków tej klasy nie jest już pusta?
+ */
+static bool PoolAdopt(size_t size_class) {
+    if (atomic_load(&orphan_lists[size_class]) == NULL) {
+        return false;
+    }
+    free_lists[size_class] = atomic_exchange(&orphan_lists[size_class], NULL);
+    return free_lists[size_class] != NULL;
+}
+
+void PoolShare(void) {
+    for (size_t size_class = 0; size_class < POOL_CLASSES; ++size_class) {
+        PoolFreeBlock *head = free_lists[size_class];
+        if (head == NULL) {
+            continue;
+        }
+        PoolFreeBlock *tail = head;
+        while (tail->next != NULL) {
+            tail = tail->next;
+        }
+        /* doklejamy całą listę przed listę oddanych bloków*/
+        tail->next = atomic_load(&orphan_lists[size_class]);
+        while (!atomic_compare_exchange_weak(&orphan_lists[size_class], &tail->next, head)) {
+        }
+        free_lists[size_class] = NULL;
+    }
+}
+
+void *PoolAlloc(size_t bytes) {
+    size_t size_class = SizeClass(bytes + sizeof(PoolHeader));
+    PoolHeader *header;
+    if (size_class == POOL_LARGE) {
+        header = malloc(sizeof(PoolHeader) + bytes);
+        if (header == NULL) {
+            exit(ERROR_EXIT_STATUS);
+        }
+    } else if (free_lists[size_class] != NULL || PoolAdopt(size_class)) {
+        /* wolny blok zaczyna się tuż za nagłówkiem */
+        header = (PoolHeader *) free_lists[size_class] - 1;
+        free_lists[size_class] = free_lists[size_class]->next;
+    } else {
+        header = PoolCarve(size_class);
+    }
+    header->size_class = size_class;
+    return header + 1;
+}
+
+void PoolFree(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    PoolHeader *header = (PoolHeader *) ptr - 1;
+    size_t size_class = header->size_class;
+    if (size_class == POOL_LARGE) {
+        free(header);
+    } else {
+        PoolFreeBlock *block = ptr;
+        block->next = free_lists[size_class];
+        free_lists[size_class] = block;
+    }
+}
+
+void *PoolRealloc(void *ptr, size_t bytes) {
+    if (ptr == NULL) {
+        return PoolAlloc(bytes);
+    }
+    PoolHeader *header = (PoolHeader *) ptr - 1;
+    size_t size_class = header->size_class;
+    if (size_class == POOL_LARGE) {
+        if (SizeClass(bytes + sizeof(PoolHeader)) != POOL_LARGE) {
+            /* blok zmalał na tyle, że mieści się w puli */
+            void *result = PoolAlloc(bytes);
+            memcpy(result, ptr, bytes);
+            free(header);
+            return result;
+        }
+        header = realloc(header, sizeof(PoolHeader) + bytes);
+        if (header == NULL) {
+            exit(ERROR_EXIT_STATUS);
+        }
+        return header + 1;
+    }
+    size_t capacity = ClassSize(size_class) - sizeof(PoolHeader);
+    if (bytes <= capacity) {
+        return ptr;
+    }
+    void *result = PoolAlloc(bytes);
+    memcpy(result, ptr, capacity);
+    PoolFree(ptr);
+    return result;
+}
+
+#else
+
+void *PoolAlloc(size_t bytes) {
+    void *result = malloc(bytes);
+    if (result == NULL) {
+        exit(ERROR_EXIT_STATUS);
+    }
+    return result;
+}
+
+void *PoolRealloc(void *ptr, size_t bytes) {
+    void *result = realloc(ptr, bytes);
+    if (result == NULL) {
+        exit(ERROR_EXIT_STATUS);
+    }
+    return result;
+}
+
+void PoolFree(void *ptr) {
+    free(ptr);
+}
+
+void PoolShare(void) {
+}
+
+#endif /* POLY_POOL_ALLOCATOR */
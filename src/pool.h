@@ -0,0 +1,63 @@
+/** @file
+  Interfejs puli pamięci
+
+  Pula przydziela bloki pamięci z list wolnych bloków podzielonych na klasy
+  rozmiarów. Zwolniony blok wraca na listę swojej klasy i jest ponownie
+  używany przy kolejnym przydziale tej samej klasy, bez wołania `malloc`
+  i `free`. Bloki większe od największej klasy są przydzielane bezpośrednio
+  przez `malloc`.
+
+  Pulę włącza się w czasie kompilacji makrem `POLY_POOL_ALLOCATOR`
+  (opcja CMake o tej samej nazwie). Bez niego funkcje puli są cienką
+  nakładką na `malloc`, `realloc` i `free`.
+
+  Każdy wątek ma własne listy wolnych bloków, więc przydział nie wymaga
+  synchronizacji. Blok można zwolnić w innym wątku niż ten, który go
+  przydzielił; trafia wtedy na listę wątku zwalniającego. Wątek, który
+  przestaje na jakiś czas przydzielać pamięć, oddaje swoje wolne bloki
+  funkcją PoolShare, a pozostałe wątki przejmują je, gdy ich własne listy
+  się wyczerpią.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/**
+ * Przydziela blok pamięci o rozmiarze co najmniej @p bytes bajtów.
+ * Jeśli zabraknie pamięci, kończy program awaryjnie kodem 1.
+ * @param[in] bytes : rozmiar bloku w bajtach
+ * @return wskaźnik na przydzielony blok
+ */
+void *PoolAlloc(size_t bytes);
+
+/**
+ * Zmienia rozmiar bloku przydzielonego przez PoolAlloc. Zawartość bloku
+ * jest zachowana do mniejszego z dwóch rozmiarów. Jeśli @p ptr jest równe
+ * NULL, działa jak PoolAlloc. Jeśli zabraknie pamięci, kończy program
+ * awaryjnie kodem 1.
+ * @param[in] ptr : blok pamięci
+ * @param[in] bytes : nowy rozmiar bloku w bajtach
+ * @return wskaźnik na blok o nowym rozmiarze
+ */
+void *PoolRealloc(void *ptr, size_t bytes);
+
+/**
+ * Zwalnia blok przydzielony przez PoolAlloc lub PoolRealloc.
+ * Jeśli @p ptr jest równe NULL, nic nie robi.
+ * @param[in] ptr : blok pamięci
+ */
+void PoolFree(void *ptr);
+
+/**
+ * Oddaje wolne bloki bieżącego wątku do wspólnej puli, z której
+ * korzystają pozostałe wątki. Woła ją wątek przed dłuższym oczekiwaniem.
+ */
+void PoolShare(void);
+
+#endif //POOL_H
@@ -0,0 +1,287 @@
+/** @file
+  Implementacja wykonywania operacji na wielu wątkach
+
+  Wątki pomocnicze są uruchamiane przy pierwszej potrzebie i działają do
+  końca programu. Każdy wątek ma własną kolejkę zadań: zadania wstawia
+  i zdejmuje z jednego końca, a bezczynne wątki kradną je z drugiego końca
+  cudzych kolejek. Wątki spoza puli korzystają ze wspólnej kolejki numer 0.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "scheduler.h"
+#include "pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Największa liczba wątków */
+#define SCHEDULER_MAX_THREADS 256
+/** Liczba nieudanych prób kradzieży, po której wątek pomocniczy zasypia */
+#define SCHEDULER_SPINS 64
+/** Początkowa pojemność kolejki zadań */
+#define SCHEDULER_DEQUE_CAPACITY 64
+
+/**
+ * To jest struktura opisująca pracę zleconą przez SchedulerParallelFor.
+ */
+typedef struct SchedulerJob {
+    SchedulerBody body; ///< funkcja wykonująca kawałek
+    void *arg; ///< wspólny argument kawałków
+    atomic_size_t pending; ///< liczba niewykonanych kawałków
+    struct SchedulerTask *tasks; ///< miejsce na zadania powstające z podziału
+    atomic_size_t used; ///< liczba zajętych miejsc na zadania
+} SchedulerJob;
+
+/**
+ * To jest struktura przechowująca zadanie: przedział kawałków jednej pracy.
+ */
+typedef struct SchedulerTask {
+    SchedulerJob *job; ///< praca
+    size_t begin; ///< pierwszy kawałek
+    size_t end; ///< kawałek za ostatnim
+} SchedulerTask;
+
+/**
+ * To jest struktura przechowująca kolejkę zadań jednego wątku.
+ * Zadania od @p top do @p bottom czekają na wykonanie.
+ */
+typedef struct SchedulerDeque {
+    pthread_mutex_t lock; ///< blokada kolejki
+    SchedulerTask **tasks; ///< tablica zadań
+    size_t top; ///< koniec, z którego kradną inne wątki
+    size_t bottom; ///< koniec, z którego korzysta właściciel
+    size_t capacity; ///< pojemność tablicy zadań
+} SchedulerDeque;
+
+/** Liczba wątków ustawiona przez SchedulerSetThreads */
+static atomic_size_t scheduler_threads = 1;
+/** Kolejki zadań; kolejka 0 należy do wątków spoza puli */
+static SchedulerDeque deques[SCHEDULER_MAX_THREADS];
+/** Numer kolejki bieżącego wątku */
+static _Thread_local size_t deque_index = 0;
+/** Zapewnia jednokrotną inicjalizację kolejek */
+static pthread_once_t deques_once = PTHREAD_ONCE_INIT;
+/** Chroni uruchamianie i usypianie wątków pomocniczych */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+/** Budzi uśpione wątki pomocnicze */
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+/** Liczba uruchomionych wątków, razem z wątkiem wołającym */
+static atomic_size_t pool_size = 1;
+/** Liczba zadań czekających we wszystkich kolejkach */
+static atomic_size_t queued = 0;
+/** Liczba uśpionych wątków pomocniczych */
+static atomic_size_t sleepers = 0;
+
+/**
+ * Inicjalizuje blokady kolejek.
+ */
+static void SchedulerInitDeques(void) {
+    for (size_t i = 0; i < SCHEDULER_MAX_THREADS; ++i) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+    }
+}
+
+/**
+ * Wstawia zadanie do kolejki bieżącego wątku i budzi uśpiony wątek.
+ * @param[in] task : zadanie
+ */
+static void SchedulerPush(SchedulerTask *task) {
+    SchedulerDeque *deque = &deques[deque_index];
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top == deque->bottom) {
+        deque->top = 0;
+        deque->bottom = 0;
+    }
+    if (deque->bottom == deque->capacity) {
+        deque->capacity = (deque->capacity == 0) ? SCHEDULER_DEQUE_CAPACITY : 2 * deque->capacity;
+        deque->tasks = PoolRealloc(deque->tasks, sizeof(SchedulerTask *) * deque->capacity);
+    }
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+    atomic_fetch_add(&queued, 1);
+    if (atomic_load(&sleepers) > 0) {
+        pthread_mutex_lock(&pool_lock);
+        pthread_cond_signal(&pool_wake);
+        pthread_mutex_unlock(&pool_lock);
+    }
+}
+
+/**
+ * Zdejmuje ostatnio wstawione zadanie z kolejki bieżącego wątku,
+ * jeśli należy ono do danej pracy.
+ * @param[in] job : praca
+ * @return zadanie lub NULL
+ */
+static SchedulerTask *SchedulerPop(const SchedulerJob *job) {
+    SchedulerDeque *deque = &deques[deque_index];
+    SchedulerTask *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom && deque->tasks[deque->bottom - 1]->job == job) {
+        task = deque->tasks[--deque->bottom];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    if (task != NULL) {
+        atomic_fetch_sub(&queued, 1);
+    }
+    return task;
+}
+
+/**
+ * Kradnie najdawniej wstawione zadanie z kolejki innego wątku.
+ * Przeszukuje kolejki wszystkich uruchomionych wątków, także tych ponad
+ * liczbę ustawioną przez SchedulerSetThreads: po jej zmniejszeniu mogą
+ * w nich zostać zadania, na które czeka praca.
+ * @return zadanie lub NULL, jeśli wszystkie kolejki są puste
+ */
+static SchedulerTask *SchedulerSteal(void) {
+    if (atomic_load(&queued) == 0) {
+        return NULL;
+    }
+    size_t count = atomic_load(&pool_size);
+    for (size_t k = 1; k <= count; ++k) {
+        SchedulerDeque *deque = &deques[(deque_index + k) % count];
+        SchedulerTask *task = NULL;
+        pthread_mutex_lock(&deque->lock);
+        if (deque->top < deque->bottom) {
+            task = deque->tasks[deque->top++];
+        }
+        pthread_mutex_unlock(&deque->lock);
+        if (task != NULL) {
+            atomic_fetch_sub(&queued, 1);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Wykonuje zadanie. Dopóki przedział ma więcej niż jeden kawałek,
+ * jego drugą połowę wstawia jako nowe zadanie do kolejki, aby mogły
+ * ją ukraść inne wątki.
+ * @param[in] task : zadanie
+ */
+static void SchedulerRunTask(SchedulerTask *task) {
+    SchedulerJob *job = task->job;
+    size_t begin = task->begin;
+    size_t end = task->end;
+    while (end - begin > 1) {
+        size_t middle = begin + (end - begin) / 2;
+        SchedulerTask *half = &job->tasks[atomic_fetch_add(&job->used, 1)];
+        *half = (SchedulerTask) {.job = job, .begin = middle, .end = end};
+        SchedulerPush(half);
+        end = middle;
+    }
+    job->body(job->arg, begin);
+    atomic_fetch_sub(&job->pending, 1);
+}
+
+/**
+ * Funkcja wątku pomocniczego: kradnie i wykonuje zadania, a gdy ich
+ * brakuje, zasypia.
+ * @param[in] arg : numer kolejki wątku
+ * @return NULL
+ */
+static void *SchedulerWorker(void *arg) {
+    deque_index = (size_t) arg;
+    size_t misses = 0;
+    for (;;) {
+        SchedulerTask *task = (deque_index < scheduler_threads) ? SchedulerSteal() : NULL;
+        if (task != NULL) {
+            SchedulerRunTask(task);
+            misses = 0;
+            continue;
+        }
+        if (++misses < SCHEDULER_SPINS) {
+            sched_yield();
+            continue;
+        }
+        /* bloki zwolnione przez ten wątek mogą się przydać innym*/
+        PoolShare();
+        pthread_mutex_lock(&pool_lock);
+        atomic_fetch_add(&sleepers, 1);
+        while (atomic_load(&queued) == 0 || deque_index >= scheduler_threads) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        atomic_fetch_sub(&sleepers, 1);
+        pthread_mutex_unlock(&pool_lock);
+        misses = 0;
+    }
+    return NULL;
+}
+
+/**
+ * Uruchamia brakujące wątki pomocnicze. Jeśli wątku nie da się
+ * uruchomić, pracę wykonają pozostałe.
+ * @param[in] count : żądana liczba wątków
+ */
+static void SchedulerStart(size_t count) {
+    pthread_once(&deques_once, SchedulerInitDeques);
+    pthread_mutex_lock(&pool_lock);
+    while (atomic_load(&pool_size) < count) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, SchedulerWorker, (void *) atomic_load(&pool_size)) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        atomic_fetch_add(&pool_size, 1);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void SchedulerSetThreads(size_t count) {
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > SCHEDULER_MAX_THREADS) {
+        count = SCHEDULER_MAX_THREADS;
+    }
+    scheduler_threads = count;
+    /* wątki ponad nową liczbę zasypiają, brakujące mogą się obudzić;
+     * zadania z kolejek uśpionych wątków ukradną pozostałe*/
+    pthread_mutex_lock(&pool_lock);
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+size_t SchedulerThreads(void) {
+    return scheduler_threads;
+}
+
+void SchedulerParallelFor(size_t count, SchedulerBody body, void *arg) {
+    if (count == 0) {
+        return;
+    }
+    size_t threads = SchedulerThreads();
+    if (threads <= 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(arg, i);
+        }
+        return;
+    }
+    SchedulerStart(threads);
+    SchedulerJob job = {.body = body, .arg = arg};
+    atomic_init(&job.pending, count);
+    atomic_init(&job.used, 0);
+    job.tasks = PoolAlloc(sizeof(SchedulerTask) * count);
+    SchedulerTask root = {.job = &job, .begin = 0, .end = count};
+    SchedulerRunTask(&root);
+    /* czekając na ukradzione zadania, wykonujemy własne albo cudze*/
+    while (atomic_load(&job.pending) > 0) {
+        SchedulerTask *task = SchedulerPop(&job);
+        if (task == NULL) {
+            task = SchedulerSteal();
+        }
+        if (task != NULL) {
+            SchedulerRunTask(task);
+        } else {
+            sched_yield();
+        }
+    }
+    PoolFree(job.tasks);
+}
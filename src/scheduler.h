@@ -0,0 +1,50 @@
+/** @file
+  Interfejs wykonywania operacji na wielu wątkach
+
+  Operacje na dużych wielomianach dzielą pracę na niezależne kawałki
+  i wykonują je na kilku wątkach. Liczbę wątków ustawia się funkcją
+  SchedulerSetThreads; domyślnie jest jeden wątek i wszystko wykonuje się
+  w wątku wołającym. Kawałki są rozdzielane przez kradzież zadań, więc
+  praca może być zlecana także z wnętrza innego kawałka: wątek czekający
+  na zakończenie swojej pracy wykonuje w tym czasie inne zadania.
+
+  @authors Yuliya Shauchuk <ys423496@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+
+/**
+ * To jest typ funkcji wykonującej jeden kawałek pracy.
+ * @param[in] arg : wspólny argument wszystkich kawałków
+ * @param[in] index : numer kawałka
+ */
+typedef void (*SchedulerBody)(void *arg, size_t index);
+
+/**
+ * Ustawia liczbę wątków wykonujących operacje.
+ * @param[in] count : liczba wątków, co najmniej 1
+ */
+void SchedulerSetThreads(size_t count);
+
+/**
+ * Daje liczbę wątków ustawioną przez SchedulerSetThreads.
+ * @return liczba wątków
+ */
+size_t SchedulerThreads(void);
+
+/**
+ * Wykonuje kawałki pracy o numerach od 0 do @p count - 1 i czeka na
+ * zakończenie wszystkich. Kawałki są rozdzielane między wątki
+ * w dowolnej kolejności, więc muszą być od siebie niezależne.
+ * @param[in] count : liczba kawałków
+ * @param[in] body : funkcja wykonująca kawałek
+ * @param[in] arg : wspólny argument kawałków
+ */
+void SchedulerParallelFor(size_t count, SchedulerBody body, void *arg);
+
+#endif //SCHEDULER_H
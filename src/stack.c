@@ -7,23 +7,15 @@
 */
 
 #include "stack.h"
-#include <stdlib.h>
+#include "pool.h"
 
 /** Początkowa pojemność stosu */
 #define STACK_INIT_CAPACITY 4
-/**
- * Kod zakończenia.
- * Jeśli wystąpi błąd krytyczny, np. zabraknie pamięci, program powinien zakończyć się awaryjnie kodem 1.
-*/
-#define ERROR_EXIT_STATUS 1
 /** Zmiana pojemnośći */
 #define CAPACITY_CHANGE 2
 
 Stack StackCreate() {
-    Poly *init_arr = (Poly *) malloc(sizeof(Poly) * STACK_INIT_CAPACITY);
-    if (init_arr == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
+    Poly *init_arr = (Poly *) PoolAlloc(sizeof(Poly) * STACK_INIT_CAPACITY);
     return (Stack) {.size = 0, .capacity = STACK_INIT_CAPACITY, .array = init_arr};
 };
 
@@ -55,11 +47,7 @@ Poly Top(const Stack *s) {
  */
 static void StackResize(Stack *s) {
     s->capacity *= CAPACITY_CHANGE;
-    Poly *new_array = (Poly *) realloc(s->array, sizeof(Poly) * s->capacity);
-    if (new_array == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
-    s->array = new_array;
+    s->array = (Poly *) PoolRealloc(s->array, sizeof(Poly) * s->capacity);
 }
 
 void Push(Stack *s, Poly *p) {
@@ -73,7 +61,7 @@ void StackDestroy(Stack *s) {
     for (size_t i = 0; i < s->size; ++i) {
         PolyDestroy(&s->array[i]);
     }
-    free(s->array);
+    PoolFree(s->array);
 }
 
 
@@ -8,23 +8,15 @@
 
 #include "vector.h"
 
-#include <stdlib.h>
+#include "pool.h"
 
 /** Początkowa pojemność wektora */
 #define VECTOR_INIT_CAPACITY 4
-/**
- * Kod zakończenia.
- * Jeśli wystąpi błąd krytyczny, np. zabraknie pamięci, program powinien zakończyć się awaryjnie kodem 1.
-*/
-#define ERROR_EXIT_STATUS 1
 /** Zmiana pojemnośći */
 #define CAPACITY_CHANGE 2
 
 Vector VectorCreate() {
-    Mono *init_arr = (Mono *) malloc(sizeof(Mono) * VECTOR_INIT_CAPACITY);
-    if (init_arr == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
+    Mono *init_arr = (Mono *) PoolAlloc(sizeof(Mono) * VECTOR_INIT_CAPACITY);
     return (Vector) {.size = 0, .capacity = VECTOR_INIT_CAPACITY, .array = init_arr};
 };
 
@@ -32,7 +24,11 @@ void VectorDestroy(Vector *vector) {
     for (size_t i = 0; i < vector->size; ++i) {
         MonoDestroy(&vector->array[i]);
     }
-    free(vector->array);
+    PoolFree(vector->array);
+}
+
+void VectorRelease(Vector *vector) {
+    PoolFree(vector->array);
 }
 
 /**
@@ -41,11 +37,7 @@ void VectorDestroy(Vector *vector) {
  */
 static void VectorResize(Vector *vector) {
     vector->capacity *= CAPACITY_CHANGE;
-    Mono *new_array = (Mono *) realloc(vector->array, sizeof(Mono) * vector->capacity);
-    if (new_array == NULL) {
-        exit(ERROR_EXIT_STATUS);
-    }
-    vector->array = new_array;
+    vector->array = (Mono *) PoolRealloc(vector->array, sizeof(Mono) * vector->capacity);
 }
 
 void VectorAdd(Vector *vector, Mono *mono) {
@@ -32,6 +32,13 @@ Vector VectorCreate();
  */
 void VectorDestroy(Vector *vector);
 
+/**
+ * Zwalnia pamięć tablicy wektora, nie usuwając jednomianów.
+ * Używana, gdy jednomiany przeszły na własność innego obiektu.
+ * @param[in,out] vector : wektor
+ */
+void VectorRelease(Vector *vector);
+
 /**
  * Wstawia jednomian do wektora.
  * Przejmuje na własność zawartość struktury wskazywanej przez @p mono.